@@ -88,6 +88,12 @@ void sortio_Class::Transfer_Tasks_Work()
   if(isMasterIO_)
     grvy_printf(INFO,"[sortio][IO/XFER] Message size for XFERS = %i\n",messageSize);
 
+  // one-sided transport: sending ranks expose an empty window (window
+  // creation is collective across XFER_COMM)
+
+  if(useRmaXfer_)
+    initRmaXfer(NULL,0);
+
   // Begin main data xfer loop -----------------------------------------------
 
   while (true)
@@ -231,18 +237,32 @@ void sortio_Class::Transfer_Tasks_Work()
 
 	      //usleep(200000); // debug testing koomie to force multipe file xfers at small scale (hack)
 
-	      MPI_Bsend(&payLoadSize,1,MPI_INT,destRank,tagLocal,XFER_COMM);
+	      if(useRmaXfer_)
+		{
+		  // one-sided put directly into the receiver's IPC
+		  // buffer; the put is complete on return so the
+		  // buffers are recycled below (after the verify dump)
+
+		  rmaSendBuffer(buffers_[bufNum],payLoadSize,destRank);
+
+		  grvy_printf(DEBUG,"[sortio][IO/XFER][%.4i] completed RMA put to rank %i\n",
+			      ioRank_,destRank);
+		}
+	      else
+		{
+		  MPI_Bsend(&payLoadSize,1,MPI_INT,destRank,tagLocal,XFER_COMM);
 
-	      MPI_Isend(buffers_[bufNum],payLoadSize,
-			MPI_UNSIGNED_CHAR,destRank,tagLocal+1,XFER_COMM,&requestHandle);
+		  MPI_Isend(buffers_[bufNum],payLoadSize,
+			    MPI_UNSIGNED_CHAR,destRank,tagLocal+1,XFER_COMM,&requestHandle);
 
-	      grvy_printf(DEBUG,"[sortio][IO/XFER][%.4i] issued iSend to rank %i (tag = %i)\n",
-			  ioRank_,destRank,tagLocal);
+		  grvy_printf(DEBUG,"[sortio][IO/XFER][%.4i] issued iSend to rank %i (tag = %i)\n",
+			      ioRank_,destRank,tagLocal);
 	      
-	      // queue up these messages as being in flight
+		  // queue up these messages as being in flight
 	  
-	      MsgRecord message(buffersPacked,requestHandle);
-	      messageQueue_.push_back(message);
+		  MsgRecord message(buffersPacked,requestHandle);
+		  messageQueue_.push_back(message);
+		}
 
 	      // verifyMode = 1 -> dump data sent to compare against
 	      // input (fixme todo; likely broken with variable message size)
@@ -257,6 +277,13 @@ void sortio_Class::Transfer_Tasks_Work()
 		  fwrite(&buffers_[bufNum][0],sizeof(char),messageSize,fp);
 		  fclose(fp);
 		}
+
+	      // the reader may refill recycled buffers at once, so RMA
+	      // buffers go back to the empty queue only after the dump
+
+	      if(useRmaXfer_)
+		for(size_t i=0;i<buffersPacked.size();i++)
+		  addBuffertoEmptyQueue(buffersPacked[i]);
 	    }
       
 	} // end if (numBuffersToTransfer > 0) 
@@ -283,6 +310,9 @@ void sortio_Class::Transfer_Tasks_Work()
   if(isMasterIO_)
     grvy_printf(INFO,"[sortio][IO/XFER][%.4i]: data XFER COMPLETED\n",ioRank_);
 
+  if(useRmaXfer_)
+    freeRmaXfer();
+
   // gather up amount delivered
 
 #if 0
@@ -380,3 +410,103 @@ int sortio_Class::CycleDestRank()
 }
 
 
+
+// -------------------------------------------------------------------------
+// One-sided (RMA) transport for the IO->XFER data stream.
+//
+// Each receiving XFER task exposes its IPC receive buffer (the "rawData"
+// SHM segment) in xferDataWin_ along with two control words in
+// xferFlagWin_:
+//
+//   flag[0] = 1 when the receiver is armed and ready for a new payload
+//   flag[1] = size of a completed payload (0 = empty)
+//
+// A sending IO task claims the receiver with an atomic compare-and-swap
+// on flag[0], MPI_Put()s the whole payload, and then publishes the
+// payload size atomically in flag[1]. This replaces the size-header
+// Bsend plus the Isend/Recv rendezvous pair of the two-sided path.
+//
+// Window creation/destruction is collective over XFER_COMM; sending
+// tasks expose zero-sized windows.
+// -------------------------------------------------------------------------
+
+void sortio_Class::initRmaXfer(unsigned char *buffer, size_t bufSize)
+{
+  assert(isXFERTask_);
+
+  MPI_Aint flagSize = (buffer == NULL) ? 0 : 2*sizeof(long);
+
+  assert( MPI_Win_create(buffer,bufSize,1,MPI_INFO_NULL,XFER_COMM,&xferDataWin_) == MPI_SUCCESS);
+  assert( MPI_Win_allocate(flagSize,sizeof(long),MPI_INFO_NULL,XFER_COMM,
+			   &xferFlags_,&xferFlagWin_) == MPI_SUCCESS);
+
+  if(flagSize > 0)
+    {
+      xferFlags_[0] = 0;
+      xferFlags_[1] = 0;
+    }
+
+  // passive target access epoch for the life of the transfer
+
+  MPI_Barrier(XFER_COMM);
+
+  assert( MPI_Win_lock_all(MPI_MODE_NOCHECK,xferDataWin_) == MPI_SUCCESS);
+  assert( MPI_Win_lock_all(MPI_MODE_NOCHECK,xferFlagWin_) == MPI_SUCCESS);
+
+  if(isMasterXFER_)
+    grvy_printf(INFO,"[sortio][IO/XFER] One-sided RMA transport enabled\n");
+
+  return;
+}
+
+void sortio_Class::freeRmaXfer()
+{
+  assert( MPI_Win_unlock_all(xferFlagWin_) == MPI_SUCCESS);
+  assert( MPI_Win_unlock_all(xferDataWin_) == MPI_SUCCESS);
+
+  assert( MPI_Win_free(&xferFlagWin_) == MPI_SUCCESS);
+  assert( MPI_Win_free(&xferDataWin_) == MPI_SUCCESS);
+
+  xferFlags_ = NULL;
+  return;
+}
+
+// -------------------------------------------------------------------------
+// rmaSendBuffer(): (sender side) wait for destRank to arm its receive
+// buffer, put the payload and publish its size. Returns once the data
+// is complete at the target.
+// -------------------------------------------------------------------------
+
+void sortio_Class::rmaSendBuffer(unsigned char *buffer, int payLoadSize, int destRank)
+{
+  const int USLEEP_INTERVAL = 1000;
+  const long armed          = 1;
+  const long claimed        = 0;
+  long result               = 0;
+  long size                 = payLoadSize;
+
+  assert(payLoadSize > 0);
+
+  // claim the receive buffer (stall while previous payload is still in use)
+
+  while(true)
+    {
+      MPI_Compare_and_swap(&claimed,&armed,&result,MPI_LONG,destRank,0,xferFlagWin_);
+      MPI_Win_flush(destRank,xferFlagWin_);
+
+      if(result == armed)
+	break;
+
+      usleep(USLEEP_INTERVAL);
+    }
+
+  // payload first, then the size flag (flush orders the two at the target)
+
+  MPI_Put(buffer,payLoadSize,MPI_UNSIGNED_CHAR,destRank,0,payLoadSize,MPI_UNSIGNED_CHAR,xferDataWin_);
+  MPI_Win_flush(destRank,xferDataWin_);
+
+  MPI_Accumulate(&size,1,MPI_LONG,destRank,1,1,MPI_LONG,MPI_REPLACE,xferFlagWin_);
+  MPI_Win_flush(destRank,xferFlagWin_);
+
+  return;
+}
@@ -0,0 +1,97 @@
+
+/**
+  @file splitterClassify.h
+  @brief Descent of 64-bit key prefixes through the implicit splitter tree.
+
+  Kernels behind seq::SplitterTree::classify(keys,n,out). Every prefix
+  walks the same number of levels of the 1-based Eytzinger tree and ends
+  at node index i in [2^levels, 2^(levels+1)). The scalar kernel
+  interleaves 16 independent walks with software prefetch; the AVX2 and
+  AVX-512 kernels walk 8 and 16 prefixes per step with 64-bit gathers.
+  They are compiled with target attributes and selected at runtime.
+  */
+
+#ifndef __SPLITTER_CLASSIFY_H_
+#define __SPLITTER_CLASSIFY_H_
+
+#include <cstddef>
+
+#if defined(__x86_64__) && defined(__GNUC__) && (!defined(__INTEL_COMPILER) || (__INTEL_COMPILER >= 1600))
+#define SPLITTER_CLASSIFY_SIMD
+#include <immintrin.h>
+#endif
+
+typedef void (*splitter_classify_fn)(const unsigned long long*, int, const unsigned long long*, size_t, size_t*);
+
+static inline void splitter_classify_scalar(const unsigned long long* t, int levels,
+                                            const unsigned long long* p, size_t n, size_t* node){
+  const size_t B = 16;
+  for(size_t b=0; b<n; b+=B){
+    const size_t m = (n-b < B) ? (n-b) : B;
+    size_t* i = node + b;
+    for(size_t j=0; j<m; j++) i[j] = 1;
+    for(int l=0; l<levels; l++)
+      for(size_t j=0; j<m; j++){
+        __builtin_prefetch(t + 16*i[j]);
+        i[j] = 2*i[j] + (t[i[j]] < p[b+j]);
+      }
+  }
+}
+
+#ifdef SPLITTER_CLASSIFY_SIMD
+
+#define SPL_AVX2   __attribute__((target("avx2")))
+#define SPL_AVX512 __attribute__((target("avx512f")))
+
+SPL_AVX2 static void splitter_classify_avx2(const unsigned long long* t, int levels,
+                                            const unsigned long long* p, size_t n, size_t* node){
+  const __m256i sign = _mm256_set1_epi64x((long long)0x8000000000000000ULL);
+  const long long* tree = (const long long*)t;
+  size_t j = 0;
+  for(; j+8<=n; j+=8){
+    __m256i p0 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(p+j)),   sign);
+    __m256i p1 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(p+j+4)), sign);
+    __m256i i0 = _mm256_set1_epi64x(1);
+    __m256i i1 = i0;
+    for(int l=0; l<levels; l++){
+      __m256i t0 = _mm256_xor_si256(_mm256_i64gather_epi64(tree, i0, 8), sign);
+      __m256i t1 = _mm256_xor_si256(_mm256_i64gather_epi64(tree, i1, 8), sign);
+      // i = 2i + (t[i] < p); the compare mask is -1 where true
+      i0 = _mm256_sub_epi64(_mm256_add_epi64(i0, i0), _mm256_cmpgt_epi64(p0, t0));
+      i1 = _mm256_sub_epi64(_mm256_add_epi64(i1, i1), _mm256_cmpgt_epi64(p1, t1));
+    }
+    _mm256_storeu_si256((__m256i*)(node+j),   i0);
+    _mm256_storeu_si256((__m256i*)(node+j+4), i1);
+  }
+  splitter_classify_scalar(t, levels, p+j, n-j, node+j);
+}
+
+SPL_AVX512 static void splitter_classify_avx512(const unsigned long long* t, int levels,
+                                                const unsigned long long* p, size_t n, size_t* node){
+  const __m512i one  = _mm512_set1_epi64(1);
+  const __m512i zero = _mm512_setzero_si512();   // defined gather pass-through
+  size_t j = 0;
+  for(; j+16<=n; j+=16){
+    __m512i p0 = _mm512_loadu_si512((const void*)(p+j));
+    __m512i p1 = _mm512_loadu_si512((const void*)(p+j+8));
+    __m512i i0 = one;
+    __m512i i1 = one;
+    for(int l=0; l<levels; l++){
+      __m512i t0 = _mm512_mask_i64gather_epi64(zero, 0xFF, i0, (const void*)t, 8);
+      __m512i t1 = _mm512_mask_i64gather_epi64(zero, 0xFF, i1, (const void*)t, 8);
+      __mmask8 m0 = _mm512_cmpgt_epu64_mask(p0, t0);
+      __mmask8 m1 = _mm512_cmpgt_epu64_mask(p1, t1);
+      i0 = _mm512_add_epi64(i0, i0);
+      i1 = _mm512_add_epi64(i1, i1);
+      i0 = _mm512_mask_add_epi64(i0, m0, i0, one);
+      i1 = _mm512_mask_add_epi64(i1, m1, i1, one);
+    }
+    _mm512_storeu_si512((void*)(node+j),   i0);
+    _mm512_storeu_si512((void*)(node+j+8), i1);
+  }
+  splitter_classify_scalar(t, levels, p+j, n-j, node+j);
+}
+
+#endif // SPLITTER_CLASSIFY_SIMD
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef __SORT_RECORD_H_
 #define __SORT_RECORD_H_
 #include <iostream>
+#include <cstring>
 
 class sortRecord {
 private:
@@ -77,37 +78,57 @@ public:
     return(record);
   }
 
-  // TODO : optimize using SIMD
+  const char *getKey() const { return key; }
+
+  // The 10-byte key is compared as a big-endian 64-bit prefix followed
+  // by a big-endian 16-bit suffix, which gives memcmp order with two
+  // integer compares.
+
+  unsigned long long keyPrefix() const {
+    unsigned long long p;
+    memcpy(&p, key, 8);
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    p = __builtin_bswap64(p);
+#endif
+    return p;
+  }
+
+  unsigned short keySuffix() const {
+    unsigned short s;
+    memcpy(&s, key+8, 2);
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    s = __builtin_bswap16(s);
+#endif
+    return s;
+  }
+
+  /// <0, 0, >0 as the key of this record is less than, equal to or greater than other's
+  int compareKey( sortRecord const &other) const {
+    const unsigned long long a = keyPrefix(), b = other.keyPrefix();
+    if (a != b) return (a < b) ? -1 : 1;
+    return (int)keySuffix() - (int)other.keySuffix();
+  }
+
+  // all comparisons (including == and !=) are on the key only
+
   bool  operator == ( sortRecord const  &other) const {
-    return (memcmp(this->key, other.key, 10) == 0);
-    // return ( (this->eka == other.eka) && (this->dva == other.dva) );
-    // return ( (*(unsigned long*)(this->key) == *(unsigned long*)(other.key)) &&  (*(unsigned short*)(this->key+8) == *(unsigned short*)(other.key+8)) );
+    return ( (keyPrefix() == other.keyPrefix()) && (keySuffix() == other.keySuffix()) );
   }
-  bool  operator < ( sortRecord const  &other) const {
-    return (memcmp(this->key, other.key, 10) < 0);
-    
-    /*
-    if (*(long*)(this->key) == *(long*)(other.key)) 
-      return (*(unsigned short*)(this->key+8) < *(unsigned short*)(other.key+8)); 
-    else
-      return (*(unsigned long*)(this->key) < *(unsigned long*)(other.key)); 
-    if (this->eka == other.eka)
-      return this->dva < other.dva;
-    else
-      return this->eka < other.eka;
-      */
+  bool  operator != ( sortRecord const  &other) const {
+    return !(*this == other);
   }
-  bool  operator <= ( sortRecord const  &other) const {
-    return (memcmp(this->key, other.key, 10) <= 0);
+  bool  operator < ( sortRecord const  &other) const {
+    const unsigned long long a = keyPrefix(), b = other.keyPrefix();
+    return (a < b) || ( (a == b) && (keySuffix() < other.keySuffix()) );
   }
   bool  operator > ( sortRecord const  &other) const {
-    return (memcmp(this->key, other.key, 10) > 0);
+    return (other < *this);
   }
-  bool  operator >= ( sortRecord const  &other) const {
-    return (memcmp(this->key, other.key, 10) >= 0);
+  bool  operator <= ( sortRecord const  &other) const {
+    return !(other < *this);
   }
-  bool  operator != ( sortRecord const  &other) const {
-    return (memcmp(this->key, other.key, 100) != 0);
+  bool  operator >= ( sortRecord const  &other) const {
+    return !(*this < other);
   }
   friend std::ostream& operator<<(std::ostream& os, const sortRecord& r1){
     os << r1.key << ' ' << r1.value << '\n';
@@ -116,6 +137,21 @@ public:
 }; 
 
 
+namespace seq {
+
+  template <typename T>
+    struct KeyPrefix;
+
+  // first 8 key bytes as a big-endian integer (memcmp order)
+
+  template <>
+    struct KeyPrefix< sortRecord > {
+      static const bool enabled = true;
+      static unsigned long long get(const sortRecord &r) { return r.keyPrefix(); }
+    };
+
+}//end namespace seq
+
 namespace par {
 
   //Forward Declaration
@@ -1,26 +1,70 @@
 #ifndef _OMP_UTILS_H_
 #define _OMP_UTILS_H_
 
+namespace seq {
+  template <typename T> class SplitterTree;
+}
+
 namespace omp_par {
 
   template <class T,class StrictWeakOrdering>
     void merge(T A_,T A_last,T B_,T B_last,T C_,int p,StrictWeakOrdering comp);
 
+  template <class T,class StrictWeakOrdering>
+    void multiway_merge(const T* const* begins, const T* const* ends, int k, T* out, StrictWeakOrdering comp);
+
+  /** @brief Thread placement policies for merge_sort */
+  enum MergePolicy { MERGE_FLAT=0, MERGE_NUMA=1 };
+
+  /** @brief Process-wide policy used by merge_sort (default MERGE_FLAT) */
+  inline int & merge_policy() { static int policy=MERGE_FLAT; return policy; }
+
   template <class T,class StrictWeakOrdering>
     void merge_sort(T A,T A_last,StrictWeakOrdering comp);
 
+  template <class T,class StrictWeakOrdering>
+    void merge_sort(T A,T A_last,StrictWeakOrdering comp,int policy);
+
   template <class T>
     void merge_sort(T A,T A_last);
 
+  template <class T>
+    void merge_sort_keys(T A,T A_last);
+
+  template <class T>
+    void radix_sort(T A,T A_last);
+
+  template <class T>
+    void inplace_sample_sort(T A,T A_last);
+
+  /** @brief Local sort algorithms selectable through local_sort() */
+  enum LocalSortMethod { MERGE_SORT=0, RADIX_SORT=1, INPLACE_SAMPLE_SORT=2 };
+
+  /** @brief Process-wide method used by local_sort() (default MERGE_SORT) */
+  inline int & local_sort_method() { static int method=MERGE_SORT; return method; }
+
+  template <class T>
+    void local_sort(T A,T A_last);
+
   template <class T>
     void merge_sort_ptrs(T A,T A_last);
 
+  template <class T,class StrictWeakOrdering>
+    void merge_sort_ptrs(T A,T A_last,StrictWeakOrdering comp);
+
   template <class T, class I>
     T reduce(T* A, I cnt);
 
   template <class T, class I>
     void scan(T* A, T* B,I cnt);
 
+  template <class T, class I>
+    void bucket_partition(T* A, I cnt, const T* spl, int k, T* B, I* disp);
+
+  template <class T, class I>
+    void bucket_partition(T* A, I cnt, const seq::SplitterTree<T>& tree, int k, T* B, I* disp,
+                          int* bkt, I* counts);
+
 }
 
 #include "ompUtils.txx"
@@ -1,8 +1,17 @@
 #include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
 #include <omp.h>
 #include <iterator>
 #include <vector>
+#include <unistd.h>
+#include <sys/syscall.h>
 #include <seqUtils.h>
+#include <splitterTree.h>
+#include <loserTree.h>
+#include <cpuDispatch.h>
+#include "taskPool.h"
 
 #ifdef SIMD_MERGE
 	#include <sseUtils.h>
@@ -16,6 +25,62 @@
 	#define MERGE_FUNCTION std
 #endif
 
+// SIMD merges only implement the natural order of T; any other
+// comparator goes through std::merge
+template <class T,class StrictWeakOrdering>
+inline void seq_merge(T A,T A_last,T B,T B_last,T C,StrictWeakOrdering comp){
+  std::merge(A,A_last,B,B_last,C,comp);
+}
+
+template <class _ValType>
+inline void seq_merge(_ValType* A,_ValType* A_last,_ValType* B,_ValType* B_last,_ValType* C,std::less<_ValType>){
+#ifdef SIMD_MERGE
+  if(!seq::simd_kernels().simdMerge){
+    std::merge(A,A_last,B,B_last,C);
+    return;
+  }
+#endif
+  MERGE_FUNCTION::merge(A,A_last,B,B_last,C);
+}
+
+// (prefix,index) tuples ordered by prefix only use the SIMD merge networks
+inline void seq_merge(KeyIndex* A,KeyIndex* A_last,KeyIndex* B,KeyIndex* B_last,KeyIndex* C,KeyIndexPrefixLess){
+  seq::simd_kernels().mergeKeyIndex(A,A_last,B,B_last,C);
+}
+
+template <class T,class StrictWeakOrdering>
+inline void seq_run_sort(T A,T A_last,StrictWeakOrdering comp){
+  std::sort(A,A_last,comp);
+}
+
+#define KEY_INDEX_RUN 32   // runs sorted with std::sort before merging
+
+// Bottom-up merge sort of tuples by prefix with the SIMD merge networks
+inline void seq_run_sort(KeyIndex* A,KeyIndex* A_last,KeyIndexPrefixLess comp){
+  size_t n=A_last-A;
+  if(n<=KEY_INDEX_RUN){
+    std::sort(A,A_last,comp);
+    return;
+  }
+  for(size_t i=0;i<n;i+=KEY_INDEX_RUN)
+    std::sort(A+i,A+std::min(n,i+KEY_INDEX_RUN),comp);
+
+  const key_index_merge_fn merge=seq::simd_kernels().mergeKeyIndex;
+  KeyIndex* S=new KeyIndex[n];
+  KeyIndex* src=A;
+  KeyIndex* dst=S;
+  for(size_t w=KEY_INDEX_RUN;w<n;w*=2){
+    for(size_t i=0;i<n;i+=2*w){
+      size_t mid=std::min(n,i+w);
+      size_t end=std::min(n,i+2*w);
+      merge(src+i,src+mid,src+mid,src+end,dst+i);
+    }
+    std::swap(src,dst);
+  }
+  if(src!=A) memcpy(A,src,n*sizeof(KeyIndex));
+  delete[] S;
+}
+
 template <class T,class StrictWeakOrdering>
 void omp_par::merge(T A_,T A_last,T B_,T B_last,T C_,int p,StrictWeakOrdering comp){
   typedef typename std::iterator_traits<T>::difference_type _DiffType;
@@ -94,66 +159,305 @@ void omp_par::merge(T A_,T A_last,T B_,T B_last,T C_,int p,StrictWeakOrdering co
     T C=C_+split_indx_A[i]+split_indx_B[i];
     //std::merge(A_+split_indx_A[i],A_+split_indx_A[i+1],B_+split_indx_B[i],B_+split_indx_B[i+1],C,comp);
     //sse<_ValType>::merge(A_+split_indx_A[i],A_+split_indx_A[i+1],B_+split_indx_B[i],B_+split_indx_B[i+1],C);
-    MERGE_FUNCTION::merge(A_+split_indx_A[i],A_+split_indx_A[i+1],B_+split_indx_B[i],B_+split_indx_B[i+1],C);
+    seq_merge(A_+split_indx_A[i],A_+split_indx_A[i+1],B_+split_indx_B[i],B_+split_indx_B[i+1],C,comp);
   }
   delete[] split_indx_A;
   delete[] split_indx_B;
 }
 
+// Exact multisequence selection: split[i] elements of run i, summing to
+// rank, such that none of them is greater than any element not taken.
+// Ties are taken from the lower numbered runs first (as in LoserTree).
+template <class T,class StrictWeakOrdering>
+void multiway_select(const T* const* begins, const T* const* ends, int k, size_t rank, StrictWeakOrdering comp, size_t* split){
+  size_t N=0;
+  for(int i=0;i<k;i++) N+=ends[i]-begins[i];
+  if(rank>=N){
+    for(int i=0;i<k;i++) split[i]=ends[i]-begins[i];
+    return;
+  }
+
+  // candidates for the rank-th element lie in [lo[i],hi[i]) of each run
+  std::vector<size_t> lo(k,0), hi(k), lb(k), ub(k);
+  for(int i=0;i<k;i++) hi[i]=ends[i]-begins[i];
+
+  while(true){
+    int m=0;
+    for(int i=1;i<k;i++)
+      if(hi[i]-lo[i]>hi[m]-lo[m]) m=i;
+    assert(hi[m]>lo[m]);
+    const T& v=begins[m][lo[m]+(hi[m]-lo[m])/2];
+
+    size_t L=0, U=0;
+    for(int i=0;i<k;i++){
+      lb[i]=std::lower_bound(begins[i],ends[i],v,comp)-begins[i];
+      ub[i]=std::upper_bound(begins[i]+lb[i],ends[i],v,comp)-begins[i];
+      L+=lb[i];
+      U+=ub[i];
+    }
+
+    if(rank<L){
+      for(int i=0;i<k;i++) hi[i]=std::min(hi[i],lb[i]);
+    }else if(rank>=U){
+      for(int i=0;i<k;i++) lo[i]=std::max(lo[i],ub[i]);
+    }else{
+      // v is the rank-th element; hand out its copies in run order
+      size_t need=rank-L;
+      for(int i=0;i<k;i++){
+        size_t take=std::min(need,ub[i]-lb[i]);
+        split[i]=lb[i]+take;
+        need-=take;
+      }
+      return;
+    }
+  }
+}
+
+// Merge part t of p (by output rank) of the k runs into out. Used by
+// one thread; the whole output is covered by parts 0..p-1.
+template <class T,class StrictWeakOrdering>
+void multiway_merge_part(const T* const* begins, const T* const* ends, int k, T* out, StrictWeakOrdering comp, int t, int p){
+  size_t N=0;
+  for(int i=0;i<k;i++) N+=ends[i]-begins[i];
+  const size_t first=(N*t)/p;
+  const size_t last =(N*(t+1))/p;
+  if(first==last) return;
+
+  std::vector<size_t> lo(k), hi(k);
+  multiway_select(begins,ends,k,first,comp,&lo[0]);
+  multiway_select(begins,ends,k,last ,comp,&hi[0]);
+
+  std::vector<const T*> b(k), e(k);
+  for(int i=0;i<k;i++){
+    b[i]=begins[i]+lo[i];
+    e[i]=begins[i]+hi[i];
+  }
+  if(k==2){
+    seq_merge((T*)b[0],(T*)e[0],(T*)b[1],(T*)e[1],out+first,comp);
+  }else{
+    seq::LoserTree<T,StrictWeakOrdering> tree(&b[0],&e[0],k,comp);
+    tree.merge(out+first,last-first);
+  }
+}
+
+// Run body(i) for i in [0,n): on the task pool when it is running,
+// otherwise in an OpenMP loop
+template <class F>
+void run_tasks(int n, F& body){
+  if(omp_par::task_pool().running()){
+    omp_par::task_pool().parallel_for(n,body);
+    return;
+  }
+  #pragma omp parallel for schedule(dynamic,1)
+  for(int i=0;i<n;i++)
+    body(i);
+}
+
+// Threads available to run_tasks
+inline int num_task_threads(){
+  if(omp_par::task_pool().running()) return omp_par::task_pool().numThreads();
+  return omp_get_max_threads();
+}
+
+// Tasks per thread for run_tasks: extra tasks let the pool balance
+// the load by stealing; OpenMP loops keep one per thread
+inline int tasks_per_thread(){
+  return omp_par::task_pool().running() ? 4 : 1;
+}
+
+template <class T,class StrictWeakOrdering>
+struct SortChunkTask{
+  T* A;
+  const size_t* split;
+  StrictWeakOrdering comp;
+  void operator()(int i){ seq_run_sort(A+split[i],A+split[i+1],comp); }
+};
+
+template <class T,class StrictWeakOrdering>
+struct MergePartTask{
+  const T* const* begins;
+  const T* const* ends;
+  int k;
+  T* out;
+  StrictWeakOrdering comp;
+  int parts;
+  void operator()(int t){ multiway_merge_part(begins,ends,k,out,comp,t,parts); }
+};
+
+template <class T>
+struct CopyTask{
+  T* dst;
+  const T* src;
+  size_t N;
+  int parts;
+  void operator()(int i){
+    size_t first=(N*i)/parts, last=(N*(i+1))/parts;
+    std::copy(src+first,src+last,dst+first);
+  }
+};
+
+/**
+  @brief Merge the k sorted runs [begins[i],ends[i]) into out in one pass.
+  The output is divided evenly among the threads by exact selection
+  (multiway_select); each thread merges its part with a seq::LoserTree,
+  or with seq_merge when there are only two runs. Equal elements are
+  taken from the lower numbered run first.
+**/
+template <class T,class StrictWeakOrdering>
+void omp_par::multiway_merge(const T* const* begins, const T* const* ends, int k, T* out, StrictWeakOrdering comp){
+  int p=num_task_threads()*tasks_per_thread();
+  size_t N=0;
+  for(int i=0;i<k;i++) N+=ends[i]-begins[i];
+  if(N==0) return;
+  if(N<(size_t)(16*p)) p=1;
+
+  MergePartTask<T,StrictWeakOrdering> task={begins,ends,k,out,comp,p};
+  run_tasks(p,task);
+}
+
+// NUMA node of the cpu the calling thread runs on (0 if unknown)
+inline int current_numa_node(){
+#ifdef SYS_getcpu
+  unsigned cpu=0, node=0;
+  if(syscall(SYS_getcpu,&cpu,&node,NULL)==0) return (int)node;
+#endif
+  return 0;
+}
+
+/**
+  @brief merge_sort for threads spread over several NUMA nodes.
+  Threads are grouped by the node they run on (threads should be bound,
+  e.g. OMP_PROC_BIND=true) and each node is given a contiguous range of
+  chunks. Every thread first-touches its slice of the scratch array and
+  sorts its chunk; each node then merges its chunks into its own part of
+  the scratch array using only its own threads. Only the final merge of
+  the per-node runs back into A reads across nodes. Returns false (and
+  does nothing) when all threads share a node.
+**/
+template <class T,class StrictWeakOrdering>
+bool merge_sort_numa(T A,T A_last,StrictWeakOrdering comp){
+  typedef typename std::iterator_traits<T>::value_type _ValType;
+
+  int p=omp_get_max_threads();
+  size_t N=A_last-A;
+
+  std::vector<int> node(p);
+  #pragma omp parallel for schedule(static,1)
+  for(int t=0;t<p;t++)
+    node[t]=current_numa_node();
+
+  // chunk c is handled by thread order[c]; a node's chunks are contiguous
+  std::vector<std::pair<int,int> > byNode(p);
+  for(int t=0;t<p;t++) byNode[t]=std::make_pair(node[t],t);
+  std::sort(byNode.begin(),byNode.end());
+  if(byNode[0].first==byNode[p-1].first) return false;
+
+  std::vector<int> chunk(p), group(p), rank(p);
+  std::vector<int> groupStart(1,0);
+  for(int c=0;c<p;c++){
+    if(c>0 && byNode[c].first!=byNode[c-1].first) groupStart.push_back(c);
+    int t=byNode[c].second;
+    chunk[t]=c;
+    group[t]=groupStart.size()-1;
+    rank [t]=c-groupStart.back();
+  }
+  const int G=groupStart.size();
+  groupStart.push_back(p);
+
+  std::vector<size_t> split(p+1);
+  for(int c=0;c<=p;c++) split[c]=(N*c)/p;
+
+  _ValType* A_=&A[0];
+  _ValType* B=new _ValType[N];
+
+  #pragma omp parallel for schedule(static,1)
+  for(int t=0;t<p;t++){
+    const int g=group[t];
+    const int n=groupStart[g+1]-groupStart[g];
+    const size_t segStart=split[groupStart[g]];
+    const size_t segLen  =split[groupStart[g+1]]-segStart;
+
+    // first touch of the slice this thread writes in the node merge
+    const size_t touch0=segStart+(segLen*rank[t])/n;
+    const size_t touch1=segStart+(segLen*(rank[t]+1))/n;
+    memset((char*)(B+touch0),0,(touch1-touch0)*sizeof(_ValType));
+
+    seq_run_sort(A_+split[chunk[t]],A_+split[chunk[t]+1],comp);
+  }
+
+  // node-local merges into B, then one merge of the node runs into A
+  std::vector<const _ValType*> begins(p), ends(p);
+  for(int c=0;c<p;c++){
+    begins[c]=A_+split[c];
+    ends  [c]=A_+split[c+1];
+  }
+
+  #pragma omp parallel for schedule(static,1)
+  for(int t=0;t<p;t++){
+    const int g=group[t];
+    const int c0=groupStart[g];
+    const int n=groupStart[g+1]-c0;
+    multiway_merge_part(&begins[c0],&ends[c0],n,B+split[c0],comp,rank[t],n);
+  }
+
+  std::vector<const _ValType*> nodeBegins(G), nodeEnds(G);
+  for(int g=0;g<G;g++){
+    nodeBegins[g]=B+split[groupStart[g]];
+    nodeEnds  [g]=B+split[groupStart[g+1]];
+  }
+  omp_par::multiway_merge(&nodeBegins[0],&nodeEnds[0],G,A_,comp);
+
+  delete[] B;
+  return true;
+}
+
 template <class T,class StrictWeakOrdering>
 void omp_par::merge_sort(T A,T A_last,StrictWeakOrdering comp){
+  omp_par::merge_sort(A,A_last,comp,omp_par::merge_policy());
+}
+
+template <class T,class StrictWeakOrdering>
+void omp_par::merge_sort(T A,T A_last,StrictWeakOrdering comp,int policy){
   typedef typename std::iterator_traits<T>::difference_type _DiffType;
   typedef typename std::iterator_traits<T>::value_type _ValType;
 
-  int p=omp_get_max_threads();
+  int p=num_task_threads();
   _DiffType N=A_last-A; 
   if(N<2*p || p==1){
-    std::sort(A,A_last,comp);
+    seq_run_sort(A,A_last,comp);
     return;
   }
 
-  //Split the array A into p equal parts.
-  _DiffType* split=new _DiffType[p+1];
-  split[p]=N;
-  #pragma omp parallel for
-  for(int id=0;id<p;id++){
+  if(policy==omp_par::MERGE_NUMA && N>=(_DiffType)(16*p) && !omp_par::task_pool().running())
+    if(merge_sort_numa(A,A_last,comp)) return;
+
+  //Split the array A into equal parts (more than one per thread on
+  //the task pool, which balances them by stealing).
+  if(omp_par::task_pool().running() && N>=(_DiffType)(64*p)) p*=2;
+  std::vector<size_t> split(p+1);
+  for(int id=0;id<=p;id++)
     split[id]=(id*N)/p;
-  }
 
   //Sort each part independently.
-  #pragma omp parallel for
-  for(int id=0;id<p;id++){
-    std::sort(A+split[id],A+split[id+1],comp);
-  }
+  _ValType* A_=&A[0];
+  SortChunkTask<_ValType,StrictWeakOrdering> sortTask={A_,&split[0],comp};
+  run_tasks(p,sortTask);
 
-  //Merge two parts at a time.
+  //Merge all parts in a single pass.
   _ValType* B=new _ValType[N];
-  _ValType* A_=&A[0];
-  _ValType* B_=&B[0];
-  for(int j=1;j<p;j=j*2){
-    for(int i=0;i<p;i=i+2*j){
-      if(i+j<p){
-	omp_par::merge(A_+split[i],A_+split[i+j],A_+split[i+j],A_+split[(i+2*j<=p?i+2*j:p)],B_+split[i],p,comp);
-      }else{
-	#pragma omp parallel for
-	for(int k=split[i];k<split[p];k++)
-	  B_[k]=A_[k];
-      }
-    }
-    _ValType* tmp_swap=A_;
-    A_=B_;
-    B_=tmp_swap;
+  std::vector<const _ValType*> begins(p), ends(p);
+  for(int id=0;id<p;id++){
+    begins[id]=A_+split[id];
+    ends  [id]=A_+split[id+1];
   }
+  omp_par::multiway_merge(&begins[0],&ends[0],p,B,comp);
 
   //The final result should be in A.
-  if(A_!=&A[0]){
-    #pragma omp parallel for
-    for(int i=0;i<N;i++)
-      A[i]=A_[i];
-  }
+  int parts=num_task_threads()*tasks_per_thread();
+  CopyTask<_ValType> copyTask={A_,B,(size_t)N,parts};
+  run_tasks(parts,copyTask);
 
   //Free memory.
-  delete[] split;
   delete[] B;
 }
 
@@ -162,10 +466,506 @@ void omp_par::merge_sort(T A,T A_last){
   typedef typename std::iterator_traits<T>::value_type _ValType;
   if(sizeof(_ValType)<=8*sizeof(_ValType*))
     omp_par::merge_sort(A,A_last,std::less<_ValType>());
+  else if(seq::KeyPrefix<_ValType>::enabled)
+    omp_par::merge_sort_keys(A,A_last);
   else
     omp_par::merge_sort_ptrs(A,A_last);
 }
 
+template <class T>
+struct KeyIndexLess{
+public:
+  const T* base;
+
+  KeyIndexLess(const T* b) : base(b) {}
+  inline bool operator() ( KeyIndex const &a, KeyIndex const &b) const {
+    if(a.prefix!=b.prefix) return a.prefix<b.prefix;
+    return base[a.indx]<base[b.indx];
+  }
+};
+
+// (prefix,index) tuple of every element of A[0:N), built in parallel
+template <class T>
+KeyIndex* make_key_index(const T* A, ptrdiff_t N){
+  int p=omp_get_max_threads();
+  KeyIndex* B=new KeyIndex[N];
+  #pragma omp parallel for
+  for(int i=0;i<p;i++){
+    ptrdiff_t start=(N*i)/p;
+    ptrdiff_t end=(N*(i+1))/p;
+    for(ptrdiff_t j=start;j<end;j++){
+      B[j].prefix=seq::KeyPrefix<T>::get(A[j]);
+      B[j].indx=j;
+    }
+  }
+  return B;
+}
+
+// Move A[B[j].indx] to A[j] for all j in place by following the
+// cycles of the permutation; B[j].indx is reset to j on the way.
+template <class T>
+void permute_by_index(T* A, KeyIndex* B, ptrdiff_t N){
+  const int AHEAD=8;
+  T tmp;
+  for(ptrdiff_t i=0;i<N;i++){
+    if((ptrdiff_t)B[i].indx==i) continue;
+
+    ptrdiff_t ahead=B[i].indx;
+    for(int d=0;d<AHEAD && ahead!=i;d++){
+      __builtin_prefetch(&A[ahead]);
+      __builtin_prefetch((char*)&A[ahead+1]-1);
+      ahead=B[ahead].indx;
+    }
+
+    tmp=A[i];
+    ptrdiff_t cur=i;
+    while(true){
+      ptrdiff_t src=B[cur].indx;
+      B[cur].indx=cur;
+      if(src==i){
+        A[cur]=tmp;
+        break;
+      }
+      A[cur]=A[src];
+      cur=src;
+
+      if(ahead!=i){
+        __builtin_prefetch(&A[ahead]);
+        __builtin_prefetch((char*)&A[ahead+1]-1);
+        ahead=B[ahead].indx;
+        __builtin_prefetch(&B[ahead]);
+      }
+    }
+  }
+}
+
+// Order every run of tuples with equal prefixes by the records. Each
+// thread handles the runs that start in its chunk.
+template <class T>
+void sort_prefix_ties(KeyIndex* B, ptrdiff_t N, const KeyIndexLess<T>& less){
+  int p=omp_get_max_threads();
+  #pragma omp parallel for
+  for(int i=0;i<p;i++){
+    ptrdiff_t start=(N*i)/p;
+    ptrdiff_t end=(N*(i+1))/p;
+    ptrdiff_t j=start;
+    if(j>0)
+      while(j<end && B[j].prefix==B[j-1].prefix) j++;
+    while(j<end){
+      ptrdiff_t k=j+1;
+      while(k<N && B[k].prefix==B[j].prefix) k++;
+      if(k-j>1) std::sort(B+j,B+k,less);
+      j=k;
+    }
+  }
+}
+
+/**
+  @brief Sort large records through 16-byte (key prefix, index) tuples.
+  Tuples are sorted by prefix with the SIMD merge networks of
+  keyIndexMerge.h, runs of equal prefixes are then ordered from the
+  (unmoved) records and the records are permuted in place
+  (permute_by_index). Extra memory is two tuple arrays instead of a copy
+  of the records.
+**/
+template <class T>
+void omp_par::merge_sort_keys(T A,T A_last){
+  typedef typename std::iterator_traits<T>::difference_type _DiffType;
+  typedef typename std::iterator_traits<T>::value_type _ValType;
+
+  _DiffType N=A_last-A;
+  if(N<2) return;
+  _ValType* A_=&A[0];
+
+  KeyIndex* B=make_key_index(A_,N);
+  omp_par::merge_sort(B,B+N,KeyIndexPrefixLess());
+  sort_prefix_ties(B,N,KeyIndexLess<_ValType>(A_));
+
+  permute_by_index(A_,B,N);
+  delete[] B;
+}
+
+#define RADIX_SMALL   64       // buckets at most this size are comparison sorted
+#define RADIX_PAR_MIN (1<<16)  // min tuples for a parallel radix pass
+
+// Sequential MSD radix sort of tuples on the prefix byte at shift and
+// below, using S as scratch. Small buckets and tuples with equal
+// prefixes are finished with std::sort.
+template <class T>
+void radix_msd(KeyIndex* B, KeyIndex* S, size_t n, int shift, const KeyIndexLess<T>& less){
+  if(n<=RADIX_SMALL || shift<0){
+    std::sort(B,B+n,less);
+    return;
+  }
+
+  size_t cnt[256];
+  memset(cnt,0,sizeof(cnt));
+  for(size_t j=0;j<n;j++)
+    cnt[(B[j].prefix>>shift)&0xff]++;
+
+  size_t off[257];
+  off[0]=0;
+  for(int b=0;b<256;b++){
+    if(cnt[b]==n){     // single digit; move on to the next byte
+      radix_msd(B,S,n,shift-8,less);
+      return;
+    }
+    off[b+1]=off[b]+cnt[b];
+  }
+
+  size_t pos[256];
+  memcpy(pos,off,sizeof(pos));
+  for(size_t j=0;j<n;j++)
+    S[pos[(B[j].prefix>>shift)&0xff]++]=B[j];
+  memcpy(B,S,n*sizeof(KeyIndex));
+
+  for(int b=0;b<256;b++)
+    if(cnt[b]>1)
+      radix_msd(B+off[b],S+off[b],cnt[b],shift-8,less);
+}
+
+// One parallel MSD pass (per-thread histograms and scatter as in
+// bucket_partition); buckets larger than n/p are split again in
+// parallel, the rest are finished by radix_msd across threads.
+template <class T>
+void radix_par(KeyIndex* B, KeyIndex* S, size_t n, int shift, const KeyIndexLess<T>& less){
+  int p=omp_get_max_threads();
+  if(p==1 || n<RADIX_PAR_MIN || shift<0){
+    radix_msd(B,S,n,shift,less);
+    return;
+  }
+
+  std::vector<size_t> counts(p*256,0);
+  #pragma omp parallel for
+  for(int i=0;i<p;i++){
+    size_t start=(n*i)/p;
+    size_t end  =(n*(i+1))/p;
+    size_t* cnt_=&counts[i*256];
+    for(size_t j=start;j<end;j++)
+      cnt_[(B[j].prefix>>shift)&0xff]++;
+  }
+
+  size_t off[257];
+  size_t sum=0;
+  for(int b=0;b<256;b++){
+    off[b]=sum;
+    for(int i=0;i<p;i++){
+      size_t c=counts[i*256+b];
+      counts[i*256+b]=sum;
+      sum+=c;
+    }
+  }
+  off[256]=sum;
+
+  #pragma omp parallel for
+  for(int i=0;i<p;i++){
+    size_t start=(n*i)/p;
+    size_t end  =(n*(i+1))/p;
+    size_t* pos=&counts[i*256];
+    for(size_t j=start;j<end;j++)
+      S[pos[(B[j].prefix>>shift)&0xff]++]=B[j];
+  }
+
+  #pragma omp parallel for
+  for(int i=0;i<p;i++){
+    size_t start=(n*i)/p;
+    size_t end  =(n*(i+1))/p;
+    memcpy(B+start,S+start,(end-start)*sizeof(KeyIndex));
+  }
+
+  const size_t big=n/p;
+  for(int b=0;b<256;b++)
+    if(off[b+1]-off[b]>big)
+      radix_par(B+off[b],S+off[b],off[b+1]-off[b],shift-8,less);
+
+  #pragma omp parallel for schedule(dynamic)
+  for(int b=0;b<256;b++){
+    size_t cnt=off[b+1]-off[b];
+    if(cnt>1 && cnt<=big)
+      radix_msd(B+off[b],S+off[b],cnt,shift-8,less);
+  }
+}
+
+/**
+  @brief Parallel MSD radix sort (8-bit digits) over the 64-bit key
+  prefix of (prefix,index) tuples; elements with equal prefixes are
+  ordered by operator<. The records are then permuted in place as in
+  merge_sort_keys. Types without a seq::KeyPrefix use merge_sort.
+**/
+template <class T>
+void omp_par::radix_sort(T A,T A_last){
+  typedef typename std::iterator_traits<T>::difference_type _DiffType;
+  typedef typename std::iterator_traits<T>::value_type _ValType;
+
+  if(!seq::KeyPrefix<_ValType>::enabled){
+    omp_par::merge_sort(A,A_last);
+    return;
+  }
+
+  _DiffType N=A_last-A;
+  if(N<2) return;
+  _ValType* A_=&A[0];
+
+  KeyIndex* B=make_key_index(A_,N);
+  KeyIndex* S=new KeyIndex[N];
+  radix_par(B,S,N,56,KeyIndexLess<_ValType>(A_));
+  delete[] S;
+
+  permute_by_index(A_,B,N);
+  delete[] B;
+}
+
+#define IPS_BLOCK_BYTES 2048     // distribution block size
+#define IPS_BUCKETS     256      // buckets per partitioning step
+#define IPS_OVERSAMPLE  16       // samples per bucket
+#define IPS_BASE        (1<<14)  // std::sort at or below this size
+#define IPS_PAR_MIN     (1<<17)  // min elements for a parallel step
+
+enum { IPS_EMPTY=0, IPS_FILLED=1, IPS_TAKING=2, IPS_DONE=3 };
+
+/**
+  @brief In-place partitioning step of inplace_sample_sort using p threads.
+  Each thread classifies its stripe of A[0:n) into small per-bucket
+  buffers and flushes every full block back to the front of its stripe.
+  Full blocks are then moved to their bucket's block-aligned region by
+  following swap chains (a per-block state claimed with atomics lets
+  threads run chains concurrently), and finally the unaligned head and
+  tail of each bucket are filled from the buffers. bs[0:k+1) returns the
+  bucket boundaries; eq[b] is set when the lower splitter of bucket b was
+  sampled more than once (a frequent key that bucket b starts with).
+**/
+template <class T>
+void ips_partition(T* A, size_t n, int p, std::vector<size_t>& bs, std::vector<char>& eq){
+  const size_t B=(sizeof(T)<IPS_BLOCK_BYTES) ? IPS_BLOCK_BYTES/sizeof(T) : 1;
+  const int k=IPS_BUCKETS;
+
+  // splitters from a regular sample
+  const size_t m=(size_t)k*IPS_OVERSAMPLE;
+  std::vector<T> sample(m);
+  for(size_t i=0;i<m;i++)
+    sample[i]=A[(n*i)/m];
+  std::sort(sample.begin(),sample.end());
+  std::vector<T> spl(k-1);
+  for(int i=0;i<k-1;i++)
+    spl[i]=sample[(m*(i+1))/k];
+  seq::SplitterTree<T> tree(&spl[0],k-1);
+
+  eq.assign(k,0);
+  for(int b=2;b<k;b++)
+    eq[b]=!(spl[b-2]<spl[b-1]);
+
+  const size_t nb=n/B;              // # full blocks in A
+  const size_t nslots=(n+B-1)/B;    // slot nb (if any) is stored in overflow
+  std::vector<unsigned char>  state(nslots,IPS_EMPTY);
+  std::vector<unsigned short> slotBucket(nslots);
+  std::vector<size_t> dest(nslots);
+  std::vector<size_t> blocks(p*k,0);   // full blocks per (thread,bucket)
+  std::vector<size_t> elems(p*k,0);    // buffered elements per (thread,bucket)
+  std::vector<size_t> wend(p);
+  std::vector<T> buf((size_t)p*k*B);
+  std::vector<T> overflow(B);
+
+  // 1. local classification
+  #pragma omp parallel for num_threads(p) if(p>1)
+  for(int t=0;t<p;t++){
+    size_t begin=((nb*t)/p)*B;
+    size_t end  =(t==p-1) ? n : ((nb*(t+1))/p)*B;
+    T* bf=&buf[(size_t)t*k*B];
+    size_t* cnt=&elems[t*k];
+    size_t* nblk=&blocks[t*k];
+    size_t w=begin;
+    int id[64];
+    for(size_t r=begin;r<end;r+=64){
+      int c=(end-r<64) ? (int)(end-r) : 64;
+      tree.classify(A+r,c,id);
+      for(int j=0;j<c;j++){
+        int b=id[j];
+        bf[b*B+cnt[b]]=A[r+j];
+        if(++cnt[b]==B){     // w+B <= r+j+1, so no unread element is overwritten
+          std::copy(bf+b*B,bf+(b+1)*B,A+w);
+          slotBucket[w/B]=b;
+          state[w/B]=IPS_FILLED;
+          w+=B;
+          cnt[b]=0;
+          nblk[b]++;
+        }
+      }
+    }
+    wend[t]=w;
+  }
+
+  // 2. bucket boundaries and block destinations
+  bs.assign(k+1,0);
+  std::vector<size_t> fb(k,0);
+  for(int b=0;b<k;b++){
+    size_t size=0;
+    for(int t=0;t<p;t++){
+      size+=blocks[t*k+b]*B+elems[t*k+b];
+      fb[b]+=blocks[t*k+b];
+    }
+    bs[b+1]=bs[b]+size;
+  }
+  assert(bs[k]==n);
+
+  std::vector<size_t> off(p*k);
+  for(int b=0;b<k;b++){
+    size_t d=(bs[b]+B-1)/B;
+    for(int t=0;t<p;t++){
+      off[t*k+b]=d;
+      d+=blocks[t*k+b];
+    }
+  }
+
+  #pragma omp parallel for num_threads(p) if(p>1)
+  for(int t=0;t<p;t++){
+    size_t* o=&off[t*k];
+    for(size_t s=(nb*t)/p;s<wend[t]/B;s++){
+      dest[s]=o[slotBucket[s]]++;
+      if(dest[s]==s) state[s]=IPS_DONE;
+    }
+  }
+
+  // 3. block permutation; every slot has at most one incoming block, so
+  //    a chain only waits for the owner of a slot to copy it out
+  #pragma omp parallel for num_threads(p) if(p>1)
+  for(int t=0;t<p;t++){
+    std::vector<T> b0(B), b1(B);
+    for(size_t s=(nb*t)/p;s<wend[t]/B;s++){
+      if(!__sync_bool_compare_and_swap(&state[s],IPS_FILLED,IPS_TAKING)) continue;
+      std::copy(A+s*B,A+(s+1)*B,b0.begin());
+      size_t d=dest[s];
+      __atomic_store_n(&state[s],IPS_EMPTY,__ATOMIC_RELEASE);
+
+      while(true){
+        T* slot=(d<nb) ? A+d*B : &overflow[0];
+        unsigned char st=__atomic_load_n(&state[d],__ATOMIC_ACQUIRE);
+        if(st==IPS_FILLED && __sync_bool_compare_and_swap(&state[d],IPS_FILLED,IPS_TAKING)){
+          std::copy(slot,slot+B,b1.begin());
+          size_t nd=dest[d];
+          std::copy(b0.begin(),b0.end(),slot);
+          __atomic_store_n(&state[d],IPS_DONE,__ATOMIC_RELEASE);
+          b0.swap(b1);
+          d=nd;
+        }else if(st==IPS_EMPTY){
+          std::copy(b0.begin(),b0.end(),slot);
+          __atomic_store_n(&state[d],IPS_DONE,__ATOMIC_RELEASE);
+          break;
+        }
+      }
+    }
+  }
+
+  // 4. cleanup: save the part of each bucket's last block that overhangs
+  //    the next bucket, then fill each bucket's head and tail
+  std::vector< std::vector<T> > ov(k);
+  #pragma omp parallel for num_threads(p) if(p>1)
+  for(int b=0;b<k;b++){
+    size_t de=((bs[b]+B-1)/B+fb[b])*B;
+    if(fb[b]>0)
+      for(size_t x=bs[b+1];x<de;x++)
+        ov[b].push_back(x<nb*B ? A[x] : overflow[x-nb*B]);
+  }
+  std::copy(overflow.begin(),overflow.begin()+(n-nb*B),A+nb*B);
+
+  #pragma omp parallel for num_threads(p) if(p>1) schedule(dynamic)
+  for(int b=0;b<k;b++){
+    size_t ds=((bs[b]+B-1)/B)*B;
+    size_t de=ds+fb[b]*B;
+    size_t headEnd  =(fb[b]>0) ? ds : bs[b+1];
+    size_t tailBegin=(fb[b]>0 && de<bs[b+1]) ? de : bs[b+1];
+
+    size_t x=bs[b];
+    for(size_t i=0;i<ov[b].size();i++){
+      if(x==headEnd) x=tailBegin;
+      A[x++]=ov[b][i];
+    }
+    for(int t=0;t<p;t++){
+      const T* bf=&buf[((size_t)t*k+b)*B];
+      for(size_t i=0;i<elems[t*k+b];i++){
+        if(x==headEnd) x=tailBegin;
+        A[x++]=bf[i];
+      }
+    }
+    assert( (x==bs[b+1]) || (x==headEnd && tailBegin==bs[b+1]) );
+  }
+}
+
+template <class T>
+void ips_sort(T* A, size_t n, int p);
+
+template <class T>
+struct IpsNotAbove{
+public:
+  T key;
+
+  IpsNotAbove(const T& k) : key(k) {}
+  inline bool operator() (T const &x) const { return !(key<x); }
+};
+
+// Sort one bucket; a bucket starting with a frequent key first moves
+// the copies of that key to its front and only sorts the rest.
+template <class T>
+void ips_sort_bucket(T* A, size_t n, int p, bool eq){
+  if(eq && n>1){
+    T* mid=std::partition(A,A+n,IpsNotAbove<T>(*std::min_element(A,A+n)));
+    n-=mid-A;
+    A=mid;
+  }
+  ips_sort(A,n,p);
+}
+
+template <class T>
+void ips_sort(T* A, size_t n, int p){
+  if(n<=IPS_BASE){
+    std::sort(A,A+n);
+    return;
+  }
+  if(n<IPS_PAR_MIN) p=1;
+
+  std::vector<size_t> bs;
+  std::vector<char> eq;
+  ips_partition(A,n,p,bs,eq);
+  const int k=bs.size()-1;
+
+  for(int b=0;b<k;b++)
+    if(bs[b+1]-bs[b]==n){   // no progress (duplicate keys)
+      std::sort(A,A+n);
+      return;
+    }
+
+  const size_t big=(p>1) ? n/p : n;
+  for(int b=0;b<k;b++)
+    if(bs[b+1]-bs[b]>big)
+      ips_sort_bucket(A+bs[b],bs[b+1]-bs[b],p,eq[b]);
+
+  #pragma omp parallel for num_threads(p) if(p>1) schedule(dynamic)
+  for(int b=0;b<k;b++)
+    if(bs[b+1]-bs[b]<=big)
+      ips_sort_bucket(A+bs[b],bs[b+1]-bs[b],1,eq[b]);
+}
+
+/**
+  @brief In-place parallel sample sort (IPS4o-style). Recursively
+  partitions A into 256 buckets with block-based distribution; extra
+  memory is a few blocks per bucket and thread instead of a copy of A.
+**/
+template <class T>
+void omp_par::inplace_sample_sort(T A,T A_last){
+  size_t N=A_last-A;
+  if(N<2) return;
+  ips_sort(&A[0],N,omp_get_max_threads());
+}
+
+template <class T>
+void omp_par::local_sort(T A,T A_last){
+  if(omp_par::local_sort_method()==omp_par::RADIX_SORT)
+    omp_par::radix_sort(A,A_last);
+  else if(omp_par::local_sort_method()==omp_par::INPLACE_SAMPLE_SORT)
+    omp_par::inplace_sample_sort(A,A_last);
+  else
+    omp_par::merge_sort(A,A_last);
+}
+
 template <class T>
 struct DataPtr{
 public:
@@ -176,8 +976,25 @@ public:
   }
 };
 
+template <class T, class StrictWeakOrdering>
+struct DataPtrLess{
+public:
+  StrictWeakOrdering comp;
+
+  DataPtrLess(StrictWeakOrdering c) : comp(c) {}
+  inline bool operator() ( DataPtr<T> const &a, DataPtr<T> const &b) const {
+    return comp(*(a.elem),*(b.elem));
+  }
+};
+
 template <class T>
 void omp_par::merge_sort_ptrs(T A,T A_last){
+  typedef typename std::iterator_traits<T>::value_type _ValType;
+  omp_par::merge_sort_ptrs(A,A_last,std::less<_ValType>());
+}
+
+template <class T,class StrictWeakOrdering>
+void omp_par::merge_sort_ptrs(T A,T A_last,StrictWeakOrdering comp){
   //std::cout<<"Using Pointer sort.\n";
   int p=omp_get_max_threads();
   typedef typename std::iterator_traits<T>::difference_type _DiffType;
@@ -196,7 +1013,7 @@ void omp_par::merge_sort_ptrs(T A,T A_last){
   }
 
   // Sort pointers.
-  omp_par::merge_sort(B,B+N,std::less<DataPtr<_ValType> >());
+  omp_par::merge_sort(B,B+N,DataPtrLess<_ValType,StrictWeakOrdering>(comp));
 
   // Copy data to its sorted position.
   #pragma omp parallel for
@@ -258,3 +1075,66 @@ void omp_par::scan(T* A, T* B,I cnt){
 }
 
 
+
+/**
+  @brief Partition A[0:cnt) into k+1 buckets defined by the sorted
+  splitters spl[0:k) without sorting (element x goes to bucket
+  upper_bound(spl,x), classified with seq::SplitterTree). Parallel
+  count pass followed by a scatter into B; disp[0:k+2) returns the
+  bucket offsets in B. The scatter is bucket-major in thread order,
+  so the partition is stable.
+**/
+template <class T, class I>
+void omp_par::bucket_partition(T* A, I cnt, const T* spl, int k, T* B, I* disp){
+  std::vector<int> bkt(cnt);
+  std::vector<I>   counts(omp_get_max_threads()*(k+1));
+  seq::SplitterTree<T> tree(spl,k);
+
+  bucket_partition(A,cnt,tree,k,B,disp,bkt.data(),counts.data());
+}
+
+/**
+  @brief As above, with caller-provided workspace so that repeated
+  partitions do not allocate: tree built for the k splitters, bkt[0:cnt)
+  for the bucket of each element and counts[0:p*(k+1)) for the
+  per-thread counts, p = omp_get_max_threads().
+**/
+template <class T, class I>
+void omp_par::bucket_partition(T* A, I cnt, const seq::SplitterTree<T>& tree, int k, T* B, I* disp,
+                               int* bkt, I* counts){
+  int p=omp_get_max_threads();
+  const int nb=k+1;
+
+  std::fill(counts,counts+p*nb,(I)0);
+
+  #pragma omp parallel for
+  for(int i=0;i<p;i++){
+    I start=(I)(((long long)cnt*i)/p);   // 64-bit product, safe for I=int
+    I end  =(I)(((long long)cnt*(i+1))/p);
+    I* cnt_=&counts[i*nb];
+    tree.classify(A+start,end-start,bkt+start);
+    for(I j=start;j<end;j++)
+      cnt_[bkt[j]]++;
+  }
+
+  // bucket-major offsets: all of bucket 0 (thread order), then bucket 1, ...
+  I sum=0;
+  for(int b=0;b<nb;b++){
+    disp[b]=sum;
+    for(int i=0;i<p;i++){
+      I c=counts[i*nb+b];
+      counts[i*nb+b]=sum;
+      sum+=c;
+    }
+  }
+  disp[nb]=sum;
+
+  #pragma omp parallel for
+  for(int i=0;i<p;i++){
+    I start=(I)(((long long)cnt*i)/p);
+    I end  =(I)(((long long)cnt*(i+1))/p);
+    I* off=&counts[i*nb];
+    for(I j=start;j<end;j++)
+      B[off[bkt[j]]++]=A[j];
+  }
+}
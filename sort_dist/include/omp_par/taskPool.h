@@ -0,0 +1,285 @@
+
+/**
+  @file taskPool.h
+  @brief Persistent work-stealing thread pool for the node-local sort kernels.
+
+  Workers are started once and sleep on a condition variable between
+  calls, so a parallel_for() costs a few queue operations instead of an
+  OpenMP region entry. Each worker owns a deque: it pops its own tasks
+  from the back and steals from the front of the others. The calling
+  thread takes part in its own loop and, while waiting for it to finish,
+  runs any queued task; nested parallel_for() calls from inside a task
+  therefore never block a worker.
+
+  Besides the owned workers, a pool can run guest workers that only
+  execute tasks while they hold a core from a ledger shared by the
+  processes of a host (shareCores()). A process donate()s its cores while
+  it is not sorting and reclaim()s them afterwards; guests hand a core
+  back after their current task once the ledger goes negative.
+  */
+
+#ifndef __TASK_POOL_H_
+#define __TASK_POOL_H_
+
+#include <cassert>
+#include <deque>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+namespace omp_par {
+
+  class TaskPool {
+    public:
+      TaskPool() : numWorkers_(0), numOwned_(1), queued_(0), done_(false), spare_(NULL) {}
+      ~TaskPool() { stop(); }
+
+      bool running() const { return numWorkers_ > 0; }
+
+      /** @brief Threads working on this process's own cores (incl. the caller) */
+      int numThreads() const { return numOwned_; }
+
+      /**
+        @brief Start the workers.
+        @param numThreads threads on own cores, including the calling thread
+        @param numGuests extra workers that run only on cores from the ledger
+        */
+      void start(int numThreads, int numGuests=0) {
+        assert(!running());
+        assert(numThreads > 0 && numGuests >= 0);
+        numOwned_   = numThreads;
+        numWorkers_ = (numThreads - 1) + numGuests;
+        done_       = false;
+        queued_     = 0;
+        if(numWorkers_ == 0) return;
+
+        pthread_mutex_init(&mutex_, NULL);
+        pthread_cond_init(&cond_, NULL);
+
+        // one queue per worker plus one shared by outside callers
+        queues_.resize(numWorkers_+1);
+        for(int i=0; i<=numWorkers_; i++)
+          pthread_mutex_init(&queues_[i].mutex, NULL);
+
+        args_.resize(numWorkers_);
+        threads_.resize(numWorkers_);
+        for(int i=0; i<numWorkers_; i++) {
+          args_[i].pool  = this;
+          args_[i].id    = i;
+          args_[i].guest = (i >= numThreads-1);
+          int ierr = pthread_create(&threads_[i], NULL, workerThread, &args_[i]);
+          assert(ierr == 0);
+        }
+      }
+
+      /** @brief Finish queued work and join the workers */
+      void stop() {
+        if(!running()) return;
+
+        pthread_mutex_lock(&mutex_);
+        done_ = true;
+        pthread_cond_broadcast(&cond_);
+        pthread_mutex_unlock(&mutex_);
+
+        for(int i=0; i<numWorkers_; i++) {
+          int ierr = pthread_join(threads_[i], NULL);
+          assert(ierr == 0);
+        }
+        for(int i=0; i<=numWorkers_; i++)
+          pthread_mutex_destroy(&queues_[i].mutex);
+        pthread_cond_destroy(&cond_);
+        pthread_mutex_destroy(&mutex_);
+
+        queues_.clear();
+        args_.clear();
+        threads_.clear();
+        numWorkers_ = 0;
+        numOwned_   = 1;
+        spare_      = NULL;
+      }
+
+      /** @brief Let guest workers draw cores from a ledger (e.g. in host shared memory) */
+      void shareCores(int* spare) { spare_ = spare; }
+
+      /** @brief Offer n cores of this process to the guests on the host */
+      void donate(int n)  { if(spare_) __sync_fetch_and_add(spare_, n); }
+
+      /** @brief Take back n donated cores */
+      void reclaim(int n) { if(spare_) __sync_fetch_and_sub(spare_, n); }
+
+      /** @brief Run body(i) for i in [0,n) and wait for all of them */
+      template <class F>
+        void parallel_for(int n, F & body) {
+          if( !running() || (n == 1) ) {
+            for(int i=0; i<n; i++) body(i);
+            return;
+          }
+
+          Batch batch;
+          batch.run     = runBody<F>;
+          batch.body    = &body;
+          batch.pending = n;
+
+          const int q = (workerId() >= 0) ? workerId() : numWorkers_;
+          pthread_mutex_lock(&queues_[q].mutex);
+          for(int i=n-1; i>=0; i--) {
+            Task t = { &batch, i };
+            queues_[q].tasks.push_back(t);
+          }
+          pthread_mutex_unlock(&queues_[q].mutex);
+
+          __sync_fetch_and_add(&queued_, n);
+          pthread_mutex_lock(&mutex_);
+          pthread_cond_broadcast(&cond_);
+          pthread_mutex_unlock(&mutex_);
+
+          // help until every task of this batch has finished
+          while(__sync_fetch_and_add(&batch.pending, 0) > 0) {
+            Task t;
+            if(take(q, t))
+              execute(t);
+            else
+              sched_yield();
+          }
+        }
+
+    private:
+      struct Batch {
+        void       (*run)(void*, int);
+        void*        body;
+        volatile int pending;
+      };
+
+      struct Task {
+        Batch* batch;
+        int    index;
+      };
+
+      struct Queue {
+        pthread_mutex_t   mutex;
+        std::deque<Task>  tasks;
+      };
+
+      struct WorkerArg {
+        TaskPool* pool;
+        int       id;
+        bool      guest;
+      };
+
+      template <class F>
+        static void runBody(void* body, int i) { (*(F*)body)(i); }
+
+      static int & workerId() { static __thread int id = -1; return id; }
+
+      // own queue from the back, then steal from the front of the others
+      bool take(int q, Task & t) {
+        pthread_mutex_lock(&queues_[q].mutex);
+        if(!queues_[q].tasks.empty()) {
+          t = queues_[q].tasks.back();
+          queues_[q].tasks.pop_back();
+          pthread_mutex_unlock(&queues_[q].mutex);
+          __sync_fetch_and_sub(&queued_, 1);
+          return true;
+        }
+        pthread_mutex_unlock(&queues_[q].mutex);
+
+        for(int d=1; d<=numWorkers_; d++) {
+          Queue & v = queues_[(q+d) % (numWorkers_+1)];
+          pthread_mutex_lock(&v.mutex);
+          if(!v.tasks.empty()) {
+            t = v.tasks.front();
+            v.tasks.pop_front();
+            pthread_mutex_unlock(&v.mutex);
+            __sync_fetch_and_sub(&queued_, 1);
+            return true;
+          }
+          pthread_mutex_unlock(&v.mutex);
+        }
+        return false;
+      }
+
+      static void execute(const Task & t) {
+        t.batch->run(t.batch->body, t.index);
+        __sync_fetch_and_sub(&t.batch->pending, 1);
+      }
+
+      bool acquireCore() {
+        if(spare_ == NULL) return false;
+        while(true) {
+          int s = *(volatile int*)spare_;
+          if(s <= 0) return false;
+          if(__sync_bool_compare_and_swap(spare_, s, s-1)) return true;
+        }
+      }
+
+      void releaseCore() { __sync_fetch_and_add(spare_, 1); }
+
+      // sleep until there is queued work (or the pool stops)
+      void waitForWork() {
+        pthread_mutex_lock(&mutex_);
+        if( (__sync_fetch_and_add(&queued_, 0) == 0) && !done_ )
+          pthread_cond_wait(&cond_, &mutex_);
+        pthread_mutex_unlock(&mutex_);
+      }
+
+      static void* workerThread(void* arg) {
+        WorkerArg* a = (WorkerArg*)arg;
+        TaskPool*  p = a->pool;
+        workerId()   = a->id;
+        bool holding = false;
+
+        while(true) {
+          if(a->guest && !holding) {
+            if(__sync_fetch_and_add(&p->queued_, 0) == 0) {
+              if(p->done_) break;
+              p->waitForWork();
+              continue;
+            }
+            if(!p->acquireCore()) {   // no spare core on the host; poll
+              usleep(2000);
+              continue;
+            }
+            holding = true;
+          }
+
+          Task t;
+          if(p->take(a->id, t)) {
+            execute(t);
+            if(holding && (*(volatile int*)p->spare_ < 0)) {
+              p->releaseCore();
+              holding = false;
+            }
+            continue;
+          }
+
+          if(holding) {
+            p->releaseCore();
+            holding = false;
+          }
+          if(p->done_ && (__sync_fetch_and_add(&p->queued_, 0) == 0)) break;
+          p->waitForWork();
+        }
+
+        if(holding) p->releaseCore();
+        return NULL;
+      }
+
+      int                       numWorkers_;
+      int                       numOwned_;
+      volatile int              queued_;     // tasks in all queues
+      volatile bool             done_;
+      int*                      spare_;      // shared core ledger (guests only)
+      std::vector<Queue>        queues_;
+      std::vector<WorkerArg>    args_;
+      std::vector<pthread_t>    threads_;
+      pthread_mutex_t           mutex_;
+      pthread_cond_t            cond_;       // work queued (or done_)
+  };
+
+  /** @brief Process-wide pool used by the sort kernels (not running by default) */
+  inline TaskPool & task_pool() { static TaskPool pool; return pool; }
+
+}//end namespace
+
+#endif
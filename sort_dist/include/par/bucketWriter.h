@@ -0,0 +1,379 @@
+
+/**
+  @file bucketWriter.h
+  @brief Persistent per-bucket append streams for out-of-core binning.
+
+  Rather than creating one file per bucket for every binning pass, a
+  BucketWriter keeps one file per bucket open for the lifetime of the
+  binning phase (basename_%03d.dat) and appends each pass as a run
+  through a large write-behind buffer. The byte offset and record
+  count of every run are recorded and written to basename.idx on
+  close() as lines of "bucket run offset count".
+
+  When opened with a non-zero queue limit, runs handed over with
+  appendOwned() are written by a background thread so that the caller
+  can continue binning immediately. Memory held by queued runs is
+  bounded by the limit; appendOwned() blocks only when it is reached.
+
+  If setSortedRuns(true) is called, the bucketing routines sort every
+  run before handing it over so that runs can later be k-way merged.
+
+  With setMemoryLimit(bytes), runs handed over with appendOwned() are
+  kept in memory while they fit within the limit and only spill to the
+  bucket files once it is reached. In-memory runs are not part of the
+  run index; they outlive close() and are retrieved with takeMemRuns().
+
+  appendOwned() may be given a VectorPool (sortArena.h): the run's
+  storage is then returned to the pool instead of freed and the caller
+  receives a pooled buffer in exchange, so steady-state binning passes
+  reuse the same run buffers.
+  */
+
+#ifndef __BUCKET_WRITER_H_
+#define __BUCKET_WRITER_H_
+
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <utility>
+#include <deque>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include "sortArena.h"
+
+namespace par {
+
+  class BucketWriter {
+    public:
+      BucketWriter() : bufSize_(0), sortedRuns_(false), memLimit_(0), memHeld_(0), spilled_(0),
+                       maxQueued_(0), queued_(0), done_(false), stallTime_(0.0) {}
+      ~BucketWriter() {
+        close();
+        for(size_t i=0; i<memRuns_.size(); i++)
+          for(size_t r=0; r<memRuns_[i].size(); r++)
+            memRuns_[i][r].release(memRuns_[i][r].owner, memRuns_[i][r].pool);
+      }
+
+      bool isOpen() const { return !fps_.empty(); }
+      bool isAsync() const { return maxQueued_ > 0; }
+      bool sortedRuns() const { return sortedRuns_; }
+      void setSortedRuns(bool flag) { sortedRuns_ = flag; }
+      void setMemoryLimit(size_t bytes) { memLimit_ = bytes; }
+
+      /** @brief Bytes of run buffers (by capacity) currently held in memory */
+      size_t memBytes() const { return memHeld_; }
+
+      /** @brief Bytes of runs written to the bucket files */
+      size_t spilledBytes() const { return spilled_; }
+      int  numBuckets() const { return fps_.size(); }
+
+      /** @brief Total time (secs) appendOwned() spent waiting on a full queue */
+      double stallTime() const { return stallTime_; }
+
+      /**
+        @brief Create (truncate) the bucket files.
+        @param basename file prefix
+        @param numBuckets number of buckets
+        @param bufSize write-behind buffer size per bucket (bytes)
+        @param maxQueued max bytes queued for the background writer (0=synchronous)
+        */
+      void open(const char* basename, int numBuckets, size_t bufSize, size_t maxQueued=0) {
+        assert(!isOpen());
+        basename_  = basename;
+        bufSize_   = bufSize;
+        maxQueued_ = maxQueued;
+        queued_    = 0;
+        done_      = false;
+        stallTime_ = 0.0;
+
+        fps_.resize(numBuckets, NULL);
+        bufs_.resize(numBuckets, NULL);
+        offsets_.assign(numBuckets, 0);
+        runs_.resize(numBuckets);
+        memRuns_.resize(numBuckets);
+        memHeld_ = 0;
+        spilled_ = 0;
+
+        char fname[1024];
+        for(int i=0; i<numBuckets; i++) {
+          sprintf(fname, "%s_%03d.dat", basename, i);
+          unlink(fname);
+          fps_[i] = fopen(fname, "wb");
+          assert(fps_[i] != NULL);
+          if(bufSize_ > 0) {
+            bufs_[i] = (char*)malloc(bufSize_);
+            assert(bufs_[i] != NULL);
+            setvbuf(fps_[i], bufs_[i], _IOFBF, bufSize_);
+          }
+        }
+
+        if(isAsync()) {
+          pthread_mutex_init(&mutex_, NULL);
+          pthread_cond_init(&condFull_,  NULL);
+          pthread_cond_init(&condEmpty_, NULL);
+          int ierr = pthread_create(&thread_, NULL, writerThread, this);
+          assert(ierr == 0);
+        }
+      }
+
+      /** @brief Append one run of numRecords records (of recSize bytes) to a bucket */
+      void append(int bucket, const void* data, long numRecords, size_t recSize) {
+        assert(bucket >= 0 && bucket < numBuckets());
+        assert(!isAsync());
+        runs_[bucket].push_back(std::make_pair(offsets_[bucket], numRecords));
+        writeRun(bucket, data, numRecords, recSize);
+        offsets_[bucket] += numRecords*recSize;
+        spilled_         += numRecords*recSize;
+      }
+
+      /**
+        @brief Append the contents of data as one run and take ownership
+        of its storage (data is left empty). In async mode the run is
+        queued for the background writer and this returns immediately
+        unless the queue limit has been reached. Runs whose storage (the
+        capacity of data, not just its size) fits within the memory limit
+        are kept in memory instead. With a pool, data is
+        left holding an empty buffer from the pool and the run's storage
+        goes back to the pool once it is no longer needed.
+        */
+      template <typename T>
+        void appendOwned(int bucket, std::vector<T> & data, VectorPool<T>* pool=NULL) {
+          // a run kept in memory holds on to all of its buffer
+          const size_t heldBytes = data.capacity()*sizeof(T);
+
+          if( (memLimit_ > 0) && (memHeld_ + heldBytes <= memLimit_) ) {
+            assert(bucket >= 0 && bucket < numBuckets());
+
+            std::vector<T>* owned = (pool != NULL) ? pool->acquire() : new std::vector<T>();
+            owned->swap(data);
+
+            Job job;
+            job.bucket     = bucket;
+            job.data       = owned->data();
+            job.numRecords = owned->size();
+            job.recSize    = sizeof(T);
+            job.held       = heldBytes;
+            job.owner      = owned;
+            job.pool       = pool;
+            job.release    = releaseVector<T>;
+
+            memRuns_[bucket].push_back(job);
+            memHeld_ += heldBytes;
+            return;
+          }
+
+          if(!isAsync()) {
+            append(bucket, data.data(), data.size(), sizeof(T));
+            if(pool != NULL)
+              data.clear();
+            else
+              std::vector<T>().swap(data);
+            return;
+          }
+
+          assert(bucket >= 0 && bucket < numBuckets());
+
+          std::vector<T>* owned = (pool != NULL) ? pool->acquire() : new std::vector<T>();
+          owned->swap(data);
+
+          Job job;
+          job.bucket     = bucket;
+          job.data       = owned->data();
+          job.numRecords = owned->size();
+          job.recSize    = sizeof(T);
+          job.held       = 0;
+          job.owner      = owned;
+          job.pool       = pool;
+          job.release    = releaseVector<T>;
+
+          const size_t bytes = job.numRecords*job.recSize;
+
+          pthread_mutex_lock(&mutex_);
+
+          // runs are written in FIFO order, so offsets are known now
+          runs_[bucket].push_back(std::make_pair(offsets_[bucket], job.numRecords));
+          offsets_[bucket] += bytes;
+          spilled_         += bytes;
+
+          if( (queued_ > 0) && (queued_ + bytes > maxQueued_) ) {
+            double start = wtime();
+            while( (queued_ > 0) && (queued_ + bytes > maxQueued_) )
+              pthread_cond_wait(&condEmpty_, &mutex_);
+            stallTime_ += wtime() - start;
+          }
+
+          queue_.push_back(job);
+          queued_ += bytes;
+          pthread_cond_signal(&condFull_);
+          pthread_mutex_unlock(&mutex_);
+        }
+
+      /** @brief Flush and close all buckets and write the run index */
+      void close() {
+        if(!isOpen()) return;
+
+        if(isAsync()) {
+          pthread_mutex_lock(&mutex_);
+          done_ = true;
+          pthread_cond_signal(&condFull_);
+          pthread_mutex_unlock(&mutex_);
+
+          int ierr = pthread_join(thread_, NULL);
+          assert(ierr == 0);
+          assert(queue_.empty());
+
+          pthread_cond_destroy(&condFull_);
+          pthread_cond_destroy(&condEmpty_);
+          pthread_mutex_destroy(&mutex_);
+          maxQueued_ = 0;
+        }
+
+        for(int i=0; i<numBuckets(); i++) {
+          fclose(fps_[i]);
+          free(bufs_[i]);
+        }
+
+        std::string iname = basename_ + ".idx";
+        FILE* fp = fopen(iname.c_str(), "w");
+        assert(fp != NULL);
+        for(int i=0; i<numBuckets(); i++)
+          for(size_t r=0; r<runs_[i].size(); r++)
+            fprintf(fp, "%d %zu %lld %ld\n", i, r, runs_[i][r].first, runs_[i][r].second);
+        fclose(fp);
+
+        fps_.clear();
+        bufs_.clear();
+        offsets_.clear();
+        runs_.clear();
+      }
+
+      /**
+        @brief Move the in-memory runs of one bucket to the end of data
+        @param bucket bucket index
+        @param data receives the records of every in-memory run
+        @param counts receives the length of each run
+        */
+      template <typename T>
+        void takeMemRuns(int bucket, std::vector<T> & data, std::vector<long> & counts) {
+          assert(bucket >= 0 && bucket < (int)memRuns_.size());
+
+          for(size_t r=0; r<memRuns_[bucket].size(); r++) {
+            Job &job = memRuns_[bucket][r];
+            assert(job.recSize == sizeof(T));
+
+            const T* src = (const T*)job.data;
+            data.insert(data.end(), src, src + job.numRecords);
+            counts.push_back(job.numRecords);
+
+            memHeld_ -= job.held;
+            job.release(job.owner, job.pool);
+          }
+          memRuns_[bucket].clear();
+        }
+
+      /**
+        @brief Read the runs recorded for one bucket from basename.idx
+        @param basename file prefix given to open()
+        @param bucket bucket index
+        @param runs (offset,count) of each run in file order
+        */
+      static void readIndex(const char* basename, int bucket, std::vector< std::pair<long long,long> > & runs) {
+        std::string iname = std::string(basename) + ".idx";
+        FILE* fp = fopen(iname.c_str(), "r");
+        assert(fp != NULL);
+
+        int b; size_t r; long long offset; long count;
+        runs.clear();
+        while(fscanf(fp, "%d %zu %lld %ld", &b, &r, &offset, &count) == 4)
+          if(b == bucket)
+            runs.push_back(std::make_pair(offset, count));
+        fclose(fp);
+      }
+
+    private:
+      struct Job {
+        int         bucket;
+        const void* data;
+        long        numRecords;
+        size_t      recSize;
+        size_t      held;         // buffer bytes charged to memHeld_ (in-memory runs)
+        void*       owner;
+        void*       pool;         // VectorPool<T> the owner returns to (or NULL)
+        void      (*release)(void*, void*);
+      };
+
+      template <typename T>
+        static void releaseVector(void* owner, void* pool) {
+          if(pool != NULL)
+            ((VectorPool<T>*)pool)->release((std::vector<T>*)owner);
+          else
+            delete (std::vector<T>*)owner;
+        }
+
+      static double wtime() {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return tv.tv_sec + 1.0e-6*tv.tv_usec;
+      }
+
+      void writeRun(int bucket, const void* data, long numRecords, size_t recSize) {
+        size_t count = (numRecords > 0) ? fwrite(data, recSize, numRecords, fps_[bucket]) : 0;
+        assert(count == (size_t)(numRecords > 0 ? numRecords : 0));
+      }
+
+      static void* writerThread(void* arg) {
+        BucketWriter* w = (BucketWriter*)arg;
+
+        pthread_mutex_lock(&w->mutex_);
+        while(true) {
+          while(w->queue_.empty() && !w->done_)
+            pthread_cond_wait(&w->condFull_, &w->mutex_);
+          if(w->queue_.empty())
+            break;
+
+          Job job = w->queue_.front();
+          w->queue_.pop_front();
+          pthread_mutex_unlock(&w->mutex_);
+
+          w->writeRun(job.bucket, job.data, job.numRecords, job.recSize);
+          job.release(job.owner, job.pool);
+
+          pthread_mutex_lock(&w->mutex_);
+          w->queued_ -= job.numRecords*job.recSize;
+          pthread_cond_signal(&w->condEmpty_);
+        }
+        pthread_mutex_unlock(&w->mutex_);
+        return NULL;
+      }
+
+      std::string basename_;
+      size_t      bufSize_;
+      bool        sortedRuns_;
+      size_t      memLimit_;     // max bytes of runs kept in memory
+      size_t      memHeld_;      // buffer bytes of runs currently in memory
+      size_t      spilled_;      // bytes of runs written to files
+      std::vector< std::vector<Job> > memRuns_;
+      std::vector<FILE*>      fps_;
+      std::vector<char*>      bufs_;
+      std::vector<long long>  offsets_;
+      std::vector< std::vector< std::pair<long long,long> > > runs_;
+
+      // background writer state (async mode only)
+      size_t           maxQueued_;   // max bytes of queued runs
+      size_t           queued_;      // bytes of currently queued runs
+      bool             done_;
+      double           stallTime_;
+      std::deque<Job>  queue_;
+      pthread_t        thread_;
+      pthread_mutex_t  mutex_;
+      pthread_cond_t   condFull_;    // queue has work (or done_)
+      pthread_cond_t   condEmpty_;   // queue space released
+  };
+
+}//end namespace
+
+#endif
+
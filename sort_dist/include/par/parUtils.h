@@ -23,6 +23,7 @@
 #include "mpi.h"
 #include <vector>
 #include "dendro.h"
+#include "bucketWriter.h"
 
 #ifdef PETSC_USE_LOG
 
@@ -441,10 +442,46 @@ namespace par {
 		
 	 template <typename T>
 	   std::vector<int> bucketDataAndWrite(std::vector<T> &in, std::vector<T> splitters, 
-					       const char* filename, MPI_Comm comm);
+					       const char* filename, MPI_Comm comm, bool isSorted=false);
+  /**
+    @brief Bins in against splitters and appends each bucket as one run to writer.
+
+    If an arena is given, its scratch and counts buffers are used for the local
+    partition and the bucket displacements and the runs are drawn from (and
+    returned to) its run pool, so repeated passes do not allocate.
+    */
+	 template <typename T>
+	   std::vector<int> bucketDataAndWrite(std::vector<T> &in, std::vector<T> &splitters, 
+					       BucketWriter &writer, MPI_Comm comm, bool isSorted=false,
+					       bool rebalance=true, SortArena<T> *arena=NULL);
 	 template <typename T>
 	   std::vector<int> bucketDataAndWriteSkewed (std::vector<T> &in, std::vector< std::pair<T, DendroIntL> > splitters,
 					 char* filename, MPI_Comm comm); 
+	 template <typename T>
+	   std::vector<int> bucketDataAndWriteSkewed (std::vector<T> &in, std::vector< std::pair<T, DendroIntL> > &splitters,
+					 BucketWriter &writer, MPI_Comm comm, bool rebalance=true,
+					 SortArena<T> *arena=NULL); 
+
+  /**
+    @brief Globally merges locally sorted runs and writes the result.
+
+    data holds the concatenation of sorted runs of lengths runCounts. Splitters are
+    chosen from regular samples of the runs, each run is range partitioned with
+    binary searches and the pieces are exchanged with a single all-to-all. The
+    received pieces are k-way merged (loser tree) by all threads in parallel, each
+    thread merging a disjoint key range and writing it at its final offset in
+    filename while merging. data is released once it has been sent. Records are
+    ordered by comp, which defaults to std::less<T>.
+
+    @return the number of records written by this rank
+    */
+  template <typename T>
+    DendroIntL mergeRunsAndWrite(std::vector<T> &data, std::vector<DendroIntL> &runCounts,
+				 const char* filename, MPI_Comm comm);
+
+  template <typename T, typename Compare>
+    DendroIntL mergeRunsAndWrite(std::vector<T> &data, std::vector<DendroIntL> &runCounts,
+				 const char* filename, MPI_Comm comm, Compare comp);
 
   /**
     @brief A parallel hyper quick sort implementation.
@@ -479,11 +516,13 @@ namespace par {
     @param in the input vector
     @param out the output vector
     @param comm the communicator
+    @param arena optional buffers for the exchange counts and the receive side (sampleSort only);
+    on return arena->scratch holds the former storage of arr
     */
   template<typename T>
     int sampleSort_largemem(std::vector<T>& in, std::vector<T> & out, MPI_Comm comm); 
   template<typename T>
-    int sampleSort(std::vector<T>& arr, MPI_Comm comm); 
+    int sampleSort(std::vector<T>& arr, MPI_Comm comm, SortArena<T> *arena=NULL); 
   template<typename T>
     int sampleSortSkewed(std::vector<T>& arr, MPI_Comm comm);
   template<typename T>
@@ -20,6 +20,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include "indexHolder.h"
+#include "loserTree.h"
 
 #ifdef _PROFILE_SORT
   #include "sort_profiler.h"
@@ -2347,7 +2348,7 @@ namespace par {
 #ifdef _PROFILE_SORT
       seq_sort.start();
 #endif
-      omp_par::merge_sort(&arr[0], &arr[arr.size()]);
+      omp_par::local_sort(&arr[0], &arr[arr.size()]);
 #ifdef _PROFILE_SORT
       seq_sort.stop();
 #endif
@@ -2528,7 +2529,7 @@ namespace par {
 #ifdef _PROFILE_SORT
       seq_sort.start();
 #endif
-      omp_par::merge_sort(&arr[0], &arr[arr.size()]);
+      omp_par::local_sort(&arr[0], &arr[arr.size()]);
 #ifdef _PROFILE_SORT
       seq_sort.stop();
 #endif
@@ -3074,7 +3075,7 @@ namespace par {
   /// ----------- low mem verison - sc13 -----------------------------------
 
   template<typename T>
-    int sampleSort(std::vector<T>& arr, MPI_Comm comm){ 
+    int sampleSort(std::vector<T>& arr, MPI_Comm comm, SortArena<T> *arena){ 
 #ifdef __PROFILE_WITH_BARRIER__
       MPI_Barrier(comm);
 #endif
@@ -3094,7 +3095,7 @@ namespace par {
 #ifdef _PROFILE_SORT
 				seq_sort.start();
 #endif
-        omp_par::merge_sort(&arr[0],&arr[arr.size()]);
+        omp_par::local_sort(&arr[0],&arr[arr.size()]);
 #ifdef _PROFILE_SORT
   			seq_sort.stop();
 		 		total_sort.stop();
@@ -3183,7 +3184,7 @@ namespace par {
 #ifdef _PROFILE_SORT
 			seq_sort.start();
 #endif
-      omp_par::merge_sort(&arr[0],&arr[arr.size()]);
+      omp_par::local_sort(&arr[0],&arr[arr.size()]);
 #ifdef _PROFILE_SORT
 			seq_sort.stop();
 #endif
@@ -3222,70 +3223,29 @@ namespace par {
 
       sendSplits.clear();
 
-      int *sendcnts = new int[npes];
-      assert(sendcnts);
-
-      int * recvcnts = new int[npes];
-      assert(recvcnts);
+      // counts and displacements live in the arena (if given) so that
+      // repeated sorts reuse them
+      std::vector<int> localCounts;
+      std::vector<int> &counts = (arena != NULL) ? arena->counts : localCounts;
+      counts.assign(4*npes, 0);
 
-      int * sdispls = new int[npes];
-      assert(sdispls);
-
-      int * rdispls = new int[npes];
-      assert(rdispls);
-
-      #pragma omp parallel for
-      for(int k = 0; k < npes; k++){
-        sendcnts[k] = 0;
-      }
+      int *sendcnts = &counts[0];
+      int *recvcnts = sendcnts + npes;
+      int *sdispls  = recvcnts + npes;
+      int *rdispls  = sdispls  + npes;
 
       {
-        int omp_p=omp_get_max_threads();
-        int* proc_split = new int[omp_p+1];
-        DendroIntL* lst_split_indx = new DendroIntL[omp_p+1];
-        proc_split[0]=0;
-        lst_split_indx[0]=0;
-        lst_split_indx[omp_p]=nelem;
-        #pragma omp parallel for
-        for(int i=1;i<omp_p;i++){
-          //proc_split[i] = seq::BinSearch(&splittersPtr[0],&splittersPtr[npes-1],arr[i*nelem/omp_p],std::less<T>());
-          proc_split[i] = std::upper_bound(&splittersPtr[0],&splittersPtr[npes-1],arr[i*(size_t)nelem/omp_p],std::less<T>())-&splittersPtr[0];
-          if(proc_split[i]<npes-1){
-            //lst_split_indx[i]=seq::BinSearch(&arr[0],&arr[nelem],splittersPtr[proc_split[i]],std::less<T>());
-            lst_split_indx[i]=std::upper_bound(&arr[0],&arr[nelem],splittersPtr[proc_split[i]],std::less<T>())-&arr[0];
-          }else{
-            proc_split[i]=npes-1;
-            lst_split_indx[i]=nelem;
-          }
-        }
+        // arr is locally sorted: elements <= splitters[k] belong to
+        // ranks <= k, so destination boundaries follow from one search
+        // per splitter instead of a per-element walk
+        std::vector<DendroIntL> bound(npes);
+        bound[npes-1] = nelem;
         #pragma omp parallel for
-        for (int i=0;i<omp_p;i++){
-          int sendcnts_=0;
-          int k=proc_split[i];
-          for (DendroIntL j = lst_split_indx[i]; j < lst_split_indx[i+1]; j++) {
-            if (arr[j] <= splitters[k]) {
-              sendcnts_++;
-            } else{
-              if(sendcnts_>0)
-                sendcnts[k]=sendcnts_;
-              sendcnts_=0;
-              k = seq::UpperBound<T>(npes-1, splittersPtr, k+1, arr[j]);
-              if (k == (npes-1) ){
-                //could not find any splitter >= arr[j]
-                sendcnts_ = (nelem - j);
-                break;
-              } else {
-                assert(k < (npes-1));
-                assert(splitters[k] >= arr[j]);
-                sendcnts_++;
-              }
-            }//end if-else
-          }//end for j
-          if(sendcnts_>0)
-            sendcnts[k]=sendcnts_;
-        }
-        delete [] lst_split_indx;
-        delete [] proc_split;
+        for(int k=0;k<npes-1;k++)
+          bound[k] = std::upper_bound(arr.data(),arr.data()+nelem,splittersPtr[k])-arr.data();
+        sendcnts[0] = bound[0];
+        for(int k=1;k<npes;k++)
+          sendcnts[k] = bound[k]-bound[k-1];
       }
 
       par::Mpi_Alltoall<int>(sendcnts, recvcnts, 1, comm);
@@ -3299,7 +3259,9 @@ namespace par {
       omp_par::scan(recvcnts,rdispls,npes);
 
       DendroIntL nsorted = rdispls[npes-1] + recvcnts[npes-1];
-      std::vector<T> SortedElem(nsorted);
+      std::vector<T> localElem;
+      std::vector<T> &SortedElem = (arena != NULL) ? arena->scratch : localElem;
+      SortedElem.resize(nsorted);
 
       T* arrPtr = NULL;
       T* SortedElemPtr = NULL;
@@ -3322,23 +3284,12 @@ namespace par {
 	 		sample_do_all2all.stop();
 #endif							
       arr.swap(SortedElem);
-      SortedElem.clear();
-      delete [] sendcnts;
-      sendcnts = NULL;
-
-      delete [] recvcnts;
-      recvcnts = NULL;
-
-      delete [] sdispls;
-      sdispls = NULL;
-
-      delete [] rdispls;
-      rdispls = NULL;
+      SortedElem.clear();    // <-- keeps its capacity for the next sort (arena)
 
 #ifdef _PROFILE_SORT
 	 		seq_sort.start();
 #endif
-      omp_par::merge_sort(&arr[0], &arr[nsorted]);
+      omp_par::local_sort(&arr[0], &arr[nsorted]);
 #ifdef _PROFILE_SORT
 	 		seq_sort.stop();
 #endif
@@ -3544,52 +3495,17 @@ namespace par {
 */
 
       {
-        int omp_p=omp_get_max_threads();
-        int* proc_split = new int[omp_p+1];
-        DendroIntL* lst_split_indx = new DendroIntL[omp_p+1];
-        proc_split[0]=0;
-        lst_split_indx[0]=0;
-        lst_split_indx[omp_p]=nelem;
-        #pragma omp parallel for
-        for(int i=1;i<omp_p;i++){
-          //proc_split[i] = seq::BinSearch(&splittersPtr[0],&splittersPtr[npes-1],arr[i*nelem/omp_p],std::less<T>());
-          proc_split[i] = std::upper_bound(&splittersPtr[0],&splittersPtr[npes-1],arr[i*(size_t)nelem/omp_p],std::less<T>())-&splittersPtr[0];
-          if(proc_split[i]<npes-1){
-            //lst_split_indx[i]=seq::BinSearch(&arr[0],&arr[nelem],splittersPtr[proc_split[i]],std::less<T>());
-            lst_split_indx[i]=std::upper_bound(&arr[0],&arr[nelem],splittersPtr[proc_split[i]],std::less<T>())-&arr[0];
-          }else{
-            proc_split[i]=npes-1;
-            lst_split_indx[i]=nelem;
-          }
-        }
+        // arr is locally sorted: elements <= splitters[k] belong to
+        // ranks <= k, so destination boundaries follow from one search
+        // per splitter instead of a per-element walk
+        std::vector<DendroIntL> bound(npes);
+        bound[npes-1] = nelem;
         #pragma omp parallel for
-        for (int i=0;i<omp_p;i++){
-          int sendcnts_=0;
-          int k=proc_split[i];
-          for (DendroIntL j = lst_split_indx[i]; j < lst_split_indx[i+1]; j++) {
-            if (arr[j] <= splitters[k]) {
-              sendcnts_++;
-            } else{
-              if(sendcnts_>0)
-                sendcnts[k]=sendcnts_;
-              sendcnts_=0;
-              k = seq::UpperBound<T>(npes-1, splittersPtr, k+1, arr[j]);
-              if (k == (npes-1) ){
-                //could not find any splitter >= arr[j]
-                sendcnts_ = (nelem - j);
-                break;
-              } else {
-                assert(k < (npes-1));
-                assert(splitters[k] >= arr[j]);
-                sendcnts_++;
-              }
-            }//end if-else
-          }//end for j
-          if(sendcnts_>0)
-            sendcnts[k]=sendcnts_;
-        }
-        delete [] lst_split_indx;
-        delete [] proc_split;
+        for(int k=0;k<npes-1;k++)
+          bound[k] = std::upper_bound(arr.data(),arr.data()+nelem,splittersPtr[k])-arr.data();
+        sendcnts[0] = bound[0];
+        for(int k=1;k<npes;k++)
+          sendcnts[k] = bound[k]-bound[k-1];
       }
 
       par::Mpi_Alltoall<int>(sendcnts, recvcnts, 1, comm);
@@ -4535,7 +4451,7 @@ namespace par {
         MPI_Comm_rank(comm, &myrank);
       
         // easier if data is locally sorted ...
-        omp_par::merge_sort(&in[0], &in[in.size()]);
+        omp_par::local_sort(&in[0], &in[in.size()]);
         
         unsigned int k = splitters.size();
 	std::vector<int> writeCounts(k,0);
@@ -4575,24 +4491,53 @@ namespace par {
 
 #else
 
+    // locally bin the data: sorted input is split with lower_bound,
+    // otherwise partition only (count + scatter against the
+    // splitters); local ordering is established in the final sort.
+    // With an arena, the partition is scattered into its scratch buffer
+    // (whose storage is then swapped with that of in) and the splitter
+    // tree, record buckets and thread counts come from the arena too.
+    template <typename T>
+    void localBucketDisp(std::vector<T> &in, std::vector<T> &splitters, bool isSorted,
+			 std::vector<int> &bucket_disp, SortArena<T> *arena=NULL) {
+        unsigned int k = splitters.size();
+        bucket_disp.resize(k+2);
+        bucket_disp[0]=0; bucket_disp[k+1] = in.size();
+
+        if(isSorted) {
+          for(unsigned int i=0; i<k; i++) bucket_disp[i+1] = std::lower_bound(&in[0], &in[in.size()], splitters[i]) - &in[0];
+        } else if(arena != NULL) {
+          const int n = in.size();
+          arena->scratch.resize(n);
+          arena->bucketOf.resize(n);
+          arena->threadCounts.resize(omp_get_max_threads()*(k+1));
+          arena->tree.build(splitters.data(), k);
+          omp_par::bucket_partition(in.data(), n, arena->tree, k, arena->scratch.data(), bucket_disp.data(),
+                                    arena->bucketOf.data(), arena->threadCounts.data());
+          in.swap(arena->scratch);
+          arena->scratch.clear();
+        } else {
+          std::vector<T> part(in.size());
+          std::vector<long> disp(k+2);
+          omp_par::bucket_partition(in.data(), (long)in.size(), splitters.data(), k, part.data(), disp.data());
+          for(unsigned int i=0; i<k+2; i++) bucket_disp[i] = disp[i];
+          in.swap(part);
+        }
+     }
+
     template <typename T>
     std::vector <int> bucketDataAndWrite(std::vector<T> &in, std::vector<T> splitters, 
-					    const char* filename, MPI_Comm comm) {
+					    const char* filename, MPI_Comm comm, bool isSorted) {
         int npes, myrank;
         MPI_Comm_size(comm, &npes);
         MPI_Comm_rank(comm, &myrank);
       
-        // easier if data is locally sorted ...
-        omp_par::merge_sort(&in[0], &in[in.size()]);
-        
         unsigned int k = splitters.size();
 	std::vector<int> writeCounts(k+1,0);
        
-        // locally bin the data.
+        // locally bin the data
         std::vector<int> bucket_size(k+1), bucket_disp(k+2); 
-        bucket_disp[0]=0; bucket_disp[k+1] = in.size();
-
-        for(int i=0; i<k; i++) bucket_disp[i+1] = std::lower_bound(&in[0], &in[in.size()], splitters[i]) - &in[0];
+        localBucketDisp(in, splitters, isSorted, bucket_disp);
         //for(int i=1; i<k; i++) bucket_disp[i] = std::lower_bound(&in[0], &in[in.size()], splitters[i]) - &in[0];
         for(int i=0; i<k+1; i++) {
           bucket_size[i] = bucket_disp[i+1] - bucket_disp[i];
@@ -4641,6 +4586,49 @@ namespace par {
 	return(writeCounts);
      }
 
+    // same as above, but each bucket is appended as a new run to the
+    // persistent per-bucket streams of the provided writer; with
+    // rebalance=false no communication is performed and each rank
+    // writes its local slice of every bucket
+    template <typename T>
+    std::vector <int> bucketDataAndWrite(std::vector<T> &in, std::vector<T> &splitters, 
+					    BucketWriter &writer, MPI_Comm comm, bool isSorted,
+					    bool rebalance, SortArena<T> *arena) {
+        unsigned int k = splitters.size();
+	std::vector<int> writeCounts(k+1,0);
+
+        assert(writer.numBuckets() == (int)(k+1));
+
+        std::vector<int> localDisp;
+        std::vector<int> &bucket_disp = (arena != NULL) ? arena->counts : localDisp;
+        localBucketDisp(in, splitters, isSorted, bucket_disp, arena);
+
+        VectorPool<T> *pool = (arena != NULL) ? &arena->runs : NULL;
+        std::vector<T> *bucket = (pool != NULL) ? pool->acquire() : new std::vector<T>();
+
+        for (unsigned int i=0; i<k+1; i++) {
+          // load balance bucket i
+          bucket->assign(in.data() + bucket_disp[i], in.data() + bucket_disp[i+1]);
+          if(rebalance)
+            par::partitionW<T>(*bucket, NULL, comm);
+
+          // buckets are only in order if the input was and no
+          // rebalancing slices were concatenated
+          if(writer.sortedRuns() && (rebalance || !isSorted) && (bucket->size() > 1))
+            omp_par::local_sort(bucket->data(), bucket->data() + bucket->size());
+
+	  writeCounts[i] = bucket->size();
+          writer.appendOwned(i, *bucket, pool);   // <-- bucket storage handed to the writer
+        }
+
+        if(pool != NULL)
+          pool->release(bucket);
+        else
+          delete bucket;
+
+	return(writeCounts);
+     }
+
 
 #endif
 
@@ -4743,8 +4731,11 @@ namespace par {
 
 //===============================================================================================================================================
 
+	 // local (sorted) bucket boundaries for skewed splitters; equal keys
+	 // are divided across ranks using the splitter's global rank
 	 template <typename T>
-	 std::vector<int> bucketDataAndWriteSkewed (std::vector<T> &in, std::vector< std::pair<T, DendroIntL> > splitters, char* filename, MPI_Comm comm) {
+	 void skewedBucketDisp (std::vector<T> &in, std::vector< std::pair<T, DendroIntL> > &splitters,
+				std::vector<int> &bucket_disp, MPI_Comm comm) {
         int npes, myrank;
         MPI_Comm_size(comm, &npes);
         MPI_Comm_rank(comm, &myrank);
@@ -4753,13 +4744,10 @@ namespace par {
         par::Mpi_Allreduce<DendroIntL>(&nelem, &totSize, 1, MPI_SUM, comm);
         
         // easier if data is locally sorted ...
-        omp_par::merge_sort(&in[0], &in[in.size()]);
+        omp_par::local_sort(&in[0], &in[in.size()]);
 
         unsigned int k = splitters.size();
-	std::vector<int> writeCounts(k+1,0);
-       
-        // locally bin the data.
-        std::vector<int> bucket_size(k+1), bucket_disp(k+2); 
+        bucket_disp.resize(k+2);
         bucket_disp[0]=0; bucket_disp[k+1] = in.size();
 
         // std::cout << myrank << ": starting local binning" << std::endl;
@@ -4789,6 +4777,17 @@ namespace par {
           }
         }
 
+     }
+
+	 template <typename T>
+	 std::vector<int> bucketDataAndWriteSkewed (std::vector<T> &in, std::vector< std::pair<T, DendroIntL> > splitters, char* filename, MPI_Comm comm) {
+        unsigned int k = splitters.size();
+	std::vector<int> writeCounts(k+1,0);
+       
+        // locally bin the data.
+        std::vector<int> bucket_size(k+1), bucket_disp(k+2); 
+        skewedBucketDisp(in, splitters, bucket_disp, comm);
+
         for(int i=0; i<k+1; i++) bucket_size[i] = bucket_disp[i+1] - bucket_disp[i]; 
 
 #if 1
@@ -4831,6 +4830,203 @@ namespace par {
 
      }
 
+	 template <typename T>
+	 std::vector<int> bucketDataAndWriteSkewed (std::vector<T> &in, std::vector< std::pair<T, DendroIntL> > &splitters,
+						    BucketWriter &writer, MPI_Comm comm, bool rebalance,
+						    SortArena<T> *arena) {
+        unsigned int k = splitters.size();
+	std::vector<int> writeCounts(k+1,0);
+
+        assert(writer.numBuckets() == (int)(k+1));
+
+        std::vector<int> localDisp;
+        std::vector<int> &bucket_disp = (arena != NULL) ? arena->counts : localDisp;
+        skewedBucketDisp(in, splitters, bucket_disp, comm);
+
+        VectorPool<T> *pool = (arena != NULL) ? &arena->runs : NULL;
+        std::vector<T> *bucket = (pool != NULL) ? pool->acquire() : new std::vector<T>();
+
+        for (unsigned int i=0; i<k+1; i++) {
+          // load balance bucket i
+          bucket->assign(in.data() + bucket_disp[i], in.data() + bucket_disp[i+1]);
+          if(rebalance)
+            par::partitionW<T>(*bucket, NULL, comm);
+
+          // sorted from above, but rebalancing concatenates slices
+          if(writer.sortedRuns() && rebalance && (bucket->size() > 1))
+            omp_par::local_sort(bucket->data(), bucket->data() + bucket->size());
+
+	  writeCounts[i] = bucket->size();
+          writer.appendOwned(i, *bucket, pool);   // <-- bucket storage handed to the writer
+        }
+
+        if(pool != NULL)
+          pool->release(bucket);
+        else
+          delete bucket;
+
+	return(writeCounts);
+     }
+
+    template <typename T>
+    DendroIntL mergeRunsAndWrite(std::vector<T> &data, std::vector<DendroIntL> &runCounts,
+				 const char* filename, MPI_Comm comm) {
+        return mergeRunsAndWrite(data, runCounts, filename, comm, std::less<T>());
+     }
+
+    template <typename T, typename Compare>
+    DendroIntL mergeRunsAndWrite(std::vector<T> &data, std::vector<DendroIntL> &runCounts,
+				 const char* filename, MPI_Comm comm, Compare comp) {
+        int npes, myrank;
+        MPI_Comm_size(comm, &npes);
+        MPI_Comm_rank(comm, &myrank);
+
+        const int    OVERSAMPLE = 32;
+        const size_t CHUNK      = (4*1024*1024)/sizeof(T);   // records per write
+
+        const int k = runCounts.size();
+        std::vector<DendroIntL> runDisp(k+1, 0);
+        for(int r=0; r<k; r++) runDisp[r+1] = runDisp[r] + runCounts[r];
+        assert(runDisp[k] == (DendroIntL)data.size());
+
+        // pick npes-1 splitters from regular samples of the sorted runs
+        std::vector<T> splitters;
+        {
+          DendroIntL nelem = data.size();
+          int numSamples = (npes > 1) ? (int)std::min<DendroIntL>(nelem, OVERSAMPLE*npes) : 0;
+          std::vector<T> samples(numSamples);
+          for(int i=0; i<numSamples; i++) samples[i] = data[(nelem*i)/numSamples];
+
+          std::vector<int> sampleCnts(npes), sampleDisp(npes, 0);
+          MPI_Allgather(&numSamples, 1, MPI_INT, sampleCnts.data(), 1, MPI_INT, comm);
+          for(int i=1; i<npes; i++) sampleDisp[i] = sampleDisp[i-1] + sampleCnts[i-1];
+          int totSamples = sampleDisp[npes-1] + sampleCnts[npes-1];
+
+          std::vector<T> allSamples(totSamples);
+          MPI_Allgatherv(samples.data(), numSamples, par::Mpi_datatype<T>::value(),
+                         allSamples.data(), sampleCnts.data(), sampleDisp.data(), par::Mpi_datatype<T>::value(), comm);
+          std::sort(allSamples.begin(), allSamples.end(), comp);
+
+          if(totSamples > 0)
+            for(int i=1; i<npes; i++) splitters.push_back(allSamples[((DendroIntL)totSamples*i)/npes]);
+        }
+
+        // range partition every run: piece (r,d) = [bnd[r][d], bnd[r][d+1])
+        const int ns = splitters.size();
+        std::vector<DendroIntL> bnd(k*(npes+1));
+        #pragma omp parallel for
+        for(int r=0; r<k; r++) {
+          const T* first = data.data() + runDisp[r];
+          const T* last  = data.data() + runDisp[r+1];
+          bnd[r*(npes+1)]        = runDisp[r];
+          bnd[r*(npes+1) + npes] = runDisp[r+1];
+          for(int d=1; d<npes; d++)
+            bnd[r*(npes+1) + d] = (d-1 < ns) ? std::upper_bound(first, last, splitters[d-1], comp) - data.data() : runDisp[r+1];
+        }
+
+        // exchange piece lengths; pieces arrive ordered by (source,run)
+        std::vector<int> sendK(npes, k), recvK(npes), sendKDisp(npes), recvKDisp(npes);
+        std::vector<int> sendLen(npes*k);
+        std::vector<int> sendCnts(npes, 0), recvCnts(npes), sendDisp(npes, 0), recvDisp(npes, 0);
+
+        MPI_Allgather(&k, 1, MPI_INT, recvK.data(), 1, MPI_INT, comm);
+        for(int d=0; d<npes; d++) {
+          sendKDisp[d] = d*k;
+          recvKDisp[d] = (d > 0) ? recvKDisp[d-1] + recvK[d-1] : 0;
+          for(int r=0; r<k; r++) {
+            sendLen[d*k + r] = bnd[r*(npes+1) + d+1] - bnd[r*(npes+1) + d];
+            sendCnts[d] += sendLen[d*k + r];
+          }
+        }
+        const int numPieces = recvKDisp[npes-1] + recvK[npes-1];
+        std::vector<int> recvLen(numPieces);
+
+        MPI_Alltoallv(sendLen.data(), sendK.data(), sendKDisp.data(), MPI_INT,
+                      recvLen.data(), recvK.data(), recvKDisp.data(), MPI_INT, comm);
+        MPI_Alltoall(sendCnts.data(), 1, MPI_INT, recvCnts.data(), 1, MPI_INT, comm);
+
+        for(int d=1; d<npes; d++) {
+          sendDisp[d] = sendDisp[d-1] + sendCnts[d-1];
+          recvDisp[d] = recvDisp[d-1] + recvCnts[d-1];
+        }
+        DendroIntL nrecv = (DendroIntL)recvDisp[npes-1] + recvCnts[npes-1];
+
+        std::vector<T> sendBuf(data.size());
+        #pragma omp parallel for
+        for(int d=0; d<npes; d++) {
+          T* dest = sendBuf.data() + sendDisp[d];
+          for(int r=0; r<k; r++) {
+            const T* src = data.data() + bnd[r*(npes+1) + d];
+            dest = std::copy(src, src + sendLen[d*k + r], dest);
+          }
+        }
+        std::vector<T>().swap(data);
+
+        std::vector<T> recvBuf(nrecv);
+        MPI_Alltoallv(sendBuf.data(), sendCnts.data(), sendDisp.data(), par::Mpi_datatype<T>::value(),
+                      recvBuf.data(), recvCnts.data(), recvDisp.data(), par::Mpi_datatype<T>::value(), comm);
+        std::vector<T>().swap(sendBuf);
+
+        std::vector<const T*> pieceBegin(numPieces), pieceEnd(numPieces);
+        {
+          const T* p = recvBuf.data();
+          for(int i=0; i<numPieces; i++) { pieceBegin[i] = p; p += recvLen[i]; pieceEnd[i] = p; }
+        }
+
+        // split the local merge into key ranges, one per thread
+        int nthreads = omp_get_max_threads();
+        if(nrecv < (DendroIntL)(nthreads*CHUNK)) nthreads = 1;
+
+        std::vector<T> pivots;
+        if(nthreads > 1) {
+          int numSamples = OVERSAMPLE*nthreads;
+          std::vector<T> samples(numSamples);
+          for(int i=0; i<numSamples; i++) samples[i] = recvBuf[(nrecv*i)/numSamples];
+          std::sort(samples.begin(), samples.end(), comp);
+          for(int t=1; t<nthreads; t++) pivots.push_back(samples[(numSamples*t)/nthreads]);
+        }
+
+        // cut[t][i] = start of thread t's range in piece i
+        std::vector<const T*> cut((nthreads+1)*numPieces);
+        std::vector<DendroIntL> outOffset(nthreads+1, 0);
+        for(int i=0; i<numPieces; i++) {
+          cut[i] = pieceBegin[i];
+          cut[nthreads*numPieces + i] = pieceEnd[i];
+          for(int t=1; t<nthreads; t++)
+            cut[t*numPieces + i] = std::lower_bound(pieceBegin[i], pieceEnd[i], pivots[t-1], comp);
+        }
+        for(int t=0; t<nthreads; t++) {
+          outOffset[t+1] = outOffset[t];
+          for(int i=0; i<numPieces; i++) outOffset[t+1] += cut[(t+1)*numPieces + i] - cut[t*numPieces + i];
+        }
+        assert(outOffset[nthreads] == nrecv);
+
+        int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        assert(fd >= 0);
+
+        #pragma omp parallel for num_threads(nthreads) schedule(static,1)
+        for(int t=0; t<nthreads; t++) {
+          seq::LoserTree<T,Compare> tree(&cut[t*numPieces], &cut[(t+1)*numPieces], numPieces, comp);
+          std::vector<T> buf(CHUNK);
+          off_t offset = (off_t)outOffset[t]*sizeof(T);
+
+          size_t n;
+          while( (n = tree.merge(buf.data(), CHUNK)) > 0 ) {
+            const char* src = (const char*)buf.data();
+            size_t remain = n*sizeof(T);
+            while(remain > 0) {
+              ssize_t nw = pwrite(fd, src, remain, offset);
+              assert(nw > 0);
+              src += nw; offset += nw; remain -= nw;
+            }
+          }
+        }
+
+        close(fd);
+
+	return(nrecv);
+     }
+
 //===============================================================================================================================================
 
 
@@ -5148,7 +5344,7 @@ namespace par {
 #ifdef _PROFILE_SORT
 				seq_sort.start();
 #endif
-        omp_par::merge_sort(&arr[0],&arr[arr.size()]);
+        omp_par::local_sort(&arr[0],&arr[arr.size()]);
 #ifdef _PROFILE_SORT
   			seq_sort.stop();
 		 		total_sort.stop();
@@ -5237,7 +5433,7 @@ namespace par {
 #ifdef _PROFILE_SORT
 			seq_sort.start();
 #endif
-      omp_par::merge_sort(&arr[0],&arr[arr.size()]);
+      omp_par::local_sort(&arr[0],&arr[arr.size()]);
 #ifdef _PROFILE_SORT
 			seq_sort.stop();
 #endif
@@ -5424,7 +5620,7 @@ namespace par {
 #ifdef _PROFILE_SORT
 	 		seq_sort.start();
 #endif
-      omp_par::merge_sort(&arr[0], &arr[nsorted]);
+      omp_par::local_sort(&arr[0], &arr[nsorted]);
 #ifdef _PROFILE_SORT
 	 		seq_sort.stop();
 #endif
@@ -0,0 +1,145 @@
+
+/**
+  @file sortArena.h
+  @brief Reusable record storage for the binning and final sort passes.
+
+  A SortArena holds the large per-task buffers of the sort (incoming
+  records, a partition/exchange workspace, the bucket of each record and
+  per-thread bucket counts used when binning, the splitter tree and the
+  count/displacement arrays of the all-to-all exchanges). It is sized once up front and
+  reused by every pass: vectors are only ever cleared, so their
+  capacity (and the pages behind it) survives from one pass to the
+  next. reserve() also touches the pages so that the first pass does
+  not take the page faults either.
+
+  Runs handed to a BucketWriter are drawn from a VectorPool: the writer
+  returns a run's buffer to the pool once it has been written (or taken
+  back from memory) and the caller receives a pooled buffer in exchange,
+  so bucketing allocates only until the pool holds enough buffers for
+  the runs in flight.
+  */
+
+#ifndef __SORT_ARENA_H_
+#define __SORT_ARENA_H_
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+#include <pthread.h>
+#include "splitterTree.h"
+
+namespace par {
+
+  /** @brief Thread-safe free list of vectors which keep their capacity */
+  template <typename T>
+    class VectorPool {
+      public:
+        VectorPool() { pthread_mutex_init(&mutex_, NULL); }
+        ~VectorPool() { clear(); pthread_mutex_destroy(&mutex_); }
+
+        /** @brief Add count buffers with room (and touched pages) for capacity records each */
+        void prefill(int count, size_t capacity) {
+          for(int i=0; i<count; i++) {
+            std::vector<T>* v = new std::vector<T>();
+            touch(*v, capacity);
+            release(v);
+          }
+        }
+
+        /** @brief An empty buffer, recycled if one is available */
+        std::vector<T>* acquire() {
+          std::vector<T>* v = NULL;
+          pthread_mutex_lock(&mutex_);
+          if(!free_.empty()) {
+            v = free_.back();
+            free_.pop_back();
+          }
+          pthread_mutex_unlock(&mutex_);
+          return (v != NULL) ? v : new std::vector<T>();
+        }
+
+        /** @brief Return a buffer obtained from acquire(); its capacity is kept */
+        void release(std::vector<T>* v) {
+          assert(v != NULL);
+          v->clear();
+          pthread_mutex_lock(&mutex_);
+          free_.push_back(v);
+          pthread_mutex_unlock(&mutex_);
+        }
+
+        /** @brief Number of buffers available without allocating */
+        int numFree() {
+          pthread_mutex_lock(&mutex_);
+          int n = free_.size();
+          pthread_mutex_unlock(&mutex_);
+          return n;
+        }
+
+        /** @brief Free the pooled buffers (buffers still acquired return later) */
+        void clear() {
+          pthread_mutex_lock(&mutex_);
+          for(size_t i=0; i<free_.size(); i++)
+            delete free_[i];
+          free_.clear();
+          pthread_mutex_unlock(&mutex_);
+        }
+
+        /** @brief Grow v to capacity records and fault its pages in; v is left empty */
+        static void touch(std::vector<T> & v, size_t capacity) {
+          v.clear();
+          v.reserve(capacity);
+          char* p = (char*)v.data();
+          const size_t bytes = v.capacity()*sizeof(T);
+          for(size_t b=0; b<bytes; b+=4096)
+            p[b] = 0;
+        }
+
+      private:
+        VectorPool(const VectorPool &);
+        VectorPool & operator= (const VectorPool &);
+
+        std::vector< std::vector<T>* > free_;
+        pthread_mutex_t                mutex_;
+    };
+
+  /** @brief Buffers of one sort task, reused across passes and bins */
+  template <typename T>
+    struct SortArena {
+      std::vector<T>   records;   // records gathered for the current pass
+      std::vector<T>   scratch;   // partition / all-to-all receive workspace
+      std::vector<int> counts;    // exchange counts and displacements
+      std::vector<int> bucketOf;  // bucket of each record while binning
+      std::vector<int> threadCounts; // per-thread bucket counts while binning
+      seq::SplitterTree<T> tree;  // splitters of the current binning pass
+      VectorPool<T>    runs;      // run buffers handed to a BucketWriter
+
+      /**
+        @brief Size the arena for passes of up to numRecords records
+        @param numRecords records per pass
+        @param numCounts entries needed in counts (e.g. 4*npes)
+        */
+      void reserve(size_t numRecords, size_t numCounts) {
+        VectorPool<T>::touch(records, numRecords);
+        VectorPool<T>::touch(scratch, numRecords);
+        VectorPool<int>::touch(bucketOf, numRecords);
+        counts.reserve(numCounts);
+      }
+
+      /** @brief Bytes currently held by records and scratch */
+      size_t bytes() const { return (records.capacity() + scratch.capacity())*sizeof(T); }
+
+      /** @brief Return all memory held by the arena */
+      void release() {
+        std::vector<T>().swap(records);
+        std::vector<T>().swap(scratch);
+        std::vector<int>().swap(counts);
+        std::vector<int>().swap(bucketOf);
+        std::vector<int>().swap(threadCounts);
+        tree = seq::SplitterTree<T>();
+        runs.clear();
+      }
+    };
+
+}//end namespace
+
+#endif
@@ -0,0 +1,98 @@
+
+/**
+  @file cpuDispatch.h
+  @brief Runtime selection of the SIMD kernels.
+
+  The merge and classify kernels are bound through function pointers
+  once, from the features of the CPU the process runs on, so a single
+  binary built without -xHost/-xavx uses AVX-512 or AVX2 where the node
+  has it and the scalar kernels elsewhere. simd_select() can cap the
+  level (e.g. to compare variants or work around a bad node).
+
+  The optional compile-time SIMD_MERGE kernels (sse/avx merges of
+  natural-order int/float arrays) are only used when the CPU supports
+  the instructions they were written for.
+  */
+
+#ifndef __CPU_DISPATCH_H_
+#define __CPU_DISPATCH_H_
+
+#include "../avx/keyIndexMerge.h"
+#include "../avx/splitterClassify.h"
+
+namespace seq {
+
+  /** @brief Kernel variants, in increasing order of capability */
+  enum SimdLevel { SIMD_AUTO=-1, SIMD_SCALAR=0, SIMD_AVX2=1, SIMD_AVX512=2 };
+
+  struct SimdKernels {
+    int                   level;
+    const char*           name;
+    key_index_merge_fn    mergeKeyIndex;   // (prefix,index) tuple merge
+    splitter_classify_fn  classify;        // SplitterTree descent
+    bool                  simdMerge;       // SIMD_MERGE kernels usable
+  };
+
+  /** @brief Highest level supported by this CPU */
+  inline int simd_detect() {
+#if defined(KEY_INDEX_SIMD) && defined(SPLITTER_CLASSIFY_SIMD)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f")) return SIMD_AVX512;
+    if(__builtin_cpu_supports("avx2"))    return SIMD_AVX2;
+#endif
+    return SIMD_SCALAR;
+  }
+
+  inline SimdKernels simd_bind(int maxLevel) {
+    int level = simd_detect();
+    if( (maxLevel != SIMD_AUTO) && (maxLevel < level) ) level = maxLevel;
+
+    SimdKernels k;
+    k.level         = SIMD_SCALAR;
+    k.name          = "scalar";
+    k.mergeKeyIndex = key_index_merge_scalar;
+    k.classify      = splitter_classify_scalar;
+    k.simdMerge     = false;
+
+#if defined(KEY_INDEX_SIMD) && defined(SPLITTER_CLASSIFY_SIMD)
+    if(level == SIMD_AVX512) {
+      k.level         = SIMD_AVX512;
+      k.name          = "avx512";
+      k.mergeKeyIndex = key_index_merge_avx512;
+      k.classify      = splitter_classify_avx512;
+    } else if(level == SIMD_AVX2) {
+      k.level         = SIMD_AVX2;
+      k.name          = "avx2";
+      k.mergeKeyIndex = key_index_merge_scalar;   // no faster AVX2 merge
+      k.classify      = splitter_classify_avx2;
+    }
+#endif
+
+#ifdef SIMD_MERGE
+    k.simdMerge = (maxLevel != SIMD_SCALAR);
+#if defined(__x86_64__) && defined(__GNUC__)
+    __builtin_cpu_init();
+#if SIMD_MERGE==128
+    k.simdMerge = k.simdMerge && __builtin_cpu_supports("sse4.1");
+#elif SIMD_MERGE==256
+    k.simdMerge = k.simdMerge && __builtin_cpu_supports("avx");
+#endif
+#endif
+#endif
+    return k;
+  }
+
+  /** @brief Kernels in use (bound on first use to the best supported level) */
+  inline SimdKernels & simd_kernels() {
+    static SimdKernels kernels = simd_bind(SIMD_AUTO);
+    return kernels;
+  }
+
+  /** @brief Rebind the kernels, using at most maxLevel (SIMD_AUTO = no cap) */
+  inline void simd_select(int maxLevel) {
+    simd_kernels() = simd_bind(maxLevel);
+  }
+
+}//end namespace
+
+#endif
@@ -0,0 +1,62 @@
+
+/**
+  @file loserTree.h
+  @brief Tournament (loser) tree for k-way merging of sorted sequences.
+  */
+
+#ifndef __LOSER_TREE_H_
+#define __LOSER_TREE_H_
+
+#include <vector>
+#include <cstddef>
+#include <functional>
+
+namespace seq {
+
+  /**
+    @brief Merges k sorted ranges [begins[i],ends[i]) in O(log k) comparisons
+    per element. Internal nodes hold the loser of each match so that a pop
+    only replays the path from the winner's leaf to the root. Equal keys are
+    taken from the lower numbered source first (stable). Elements are
+    ordered by comp (std::less<T> by default).
+
+    The ranges must remain valid for the lifetime of the tree.
+    */
+  template <typename T, typename Compare = std::less<T> >
+    class LoserTree {
+      public:
+        LoserTree(const T* const* begins, const T* const* ends, int k, Compare comp = Compare());
+
+        /** @brief true once all sources are exhausted */
+        bool empty() const { return cur_[winner_] == end_[winner_]; }
+
+        /** @brief smallest remaining element */
+        const T & top() const { return *cur_[winner_]; }
+
+        /** @brief source index of top() */
+        int topSource() const { return winner_; }
+
+        /** @brief remove top() and advance its source */
+        void pop();
+
+        /** @brief pop up to n elements into out; returns the # written */
+        size_t merge(T* out, size_t n);
+
+      private:
+        bool beats(int a, int b) const;
+        int  build(int node);
+
+        Compare comp_;
+        int K_;                       // # leaves (power of 2 >= k)
+        int winner_;
+        std::vector<int>      tree_;  // losers of internal nodes [1,K_)
+        std::vector<const T*> cur_;
+        std::vector<const T*> end_;
+    };
+
+}//end namespace
+
+#include "loserTree.txx"
+
+#endif
+
@@ -0,0 +1,65 @@
+
+/**
+  @file loserTree.txx
+  @brief Definitions of the LoserTree class.
+ */
+
+#include <algorithm>
+
+namespace seq {
+
+  template <typename T, typename Compare>
+    LoserTree<T,Compare>::LoserTree(const T* const* begins, const T* const* ends, int k, Compare comp) : comp_(comp) {
+      K_ = 1;
+      while(K_ < k) K_ *= 2;
+
+      // padding leaves are empty sources
+      cur_.assign(K_, (const T*)NULL);
+      end_.assign(K_, (const T*)NULL);
+      for(int i=0; i<k; i++) { cur_[i] = begins[i]; end_[i] = ends[i]; }
+
+      tree_.resize(K_);
+      winner_ = build(1);
+    }
+
+  template <typename T, typename Compare>
+    inline bool LoserTree<T,Compare>::beats(int a, int b) const {
+      if(cur_[a] == end_[a]) return false;
+      if(cur_[b] == end_[b]) return true;
+      if(comp_(*cur_[a], *cur_[b])) return true;
+      if(comp_(*cur_[b], *cur_[a])) return false;
+      return (a < b);
+    }
+
+  template <typename T, typename Compare>
+    int LoserTree<T,Compare>::build(int node) {
+      if(node >= K_) return node - K_;
+
+      int l = build(2*node);
+      int r = build(2*node + 1);
+      if(beats(l, r)) { tree_[node] = r; return l; }
+      tree_[node] = l;
+      return r;
+    }
+
+  template <typename T, typename Compare>
+    inline void LoserTree<T,Compare>::pop() {
+      int w = winner_;
+      ++cur_[w];
+      for(int node = (w + K_)/2; node >= 1; node /= 2)
+        if(beats(tree_[node], w)) std::swap(tree_[node], w);
+      winner_ = w;
+    }
+
+  template <typename T, typename Compare>
+    size_t LoserTree<T,Compare>::merge(T* out, size_t n) {
+      size_t i = 0;
+      while( (i < n) && !empty() ) {
+        out[i++] = top();
+        pop();
+      }
+      return i;
+    }
+
+}//end namespace
+
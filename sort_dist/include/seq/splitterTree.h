@@ -0,0 +1,69 @@
+
+/**
+  @file splitterTree.h
+  @brief Branch-free classification of keys against a sorted set of splitters.
+  */
+
+#ifndef __SPLITTER_TREE_H_
+#define __SPLITTER_TREE_H_
+
+#include <vector>
+#include <cstddef>
+
+namespace seq {
+
+  /**
+    @brief Order-preserving 64-bit key prefix used by SplitterTree.
+    Types that can provide one specialize this struct (with enabled = true);
+    if prefix(a) < prefix(b) then a < b must hold.
+    */
+  template <typename T>
+    struct KeyPrefix {
+      static const bool enabled = false;
+      static unsigned long long get(const T &) { return 0; }
+    };
+
+  /**
+    @brief Classifies keys into the k+1 buckets defined by k sorted splitters.
+    The bucket of x is the number of splitters <= x (std::upper_bound semantics).
+
+    Splitter prefixes are stored as an implicit (Eytzinger) search tree padded
+    to a complete tree so that every lookup descends a fixed number of levels
+    without branches; batches go through the classify kernel selected at
+    runtime (seq::simd_kernels()). The full
+    comparison is only used on prefix ties. Types without a KeyPrefix fall back
+    to std::upper_bound.
+
+    The splitters must remain valid for the lifetime of the tree.
+    */
+  template <typename T>
+    class SplitterTree {
+      public:
+        SplitterTree() : splitters_(NULL), k_(0), levels_(0) {}
+        SplitterTree(const T* splitters, int k);
+
+        /** @brief (Re)build for new splitters, reusing the storage of the tree */
+        void build(const T* splitters, int k);
+
+        /** @brief bucket for a single key */
+        int classify(const T & key) const;
+
+        /** @brief buckets for keys[0:n) written to out[0:n) */
+        void classify(const T* keys, size_t n, int* out) const;
+
+      private:
+        int resolve(const T & key, unsigned long long prefix, int lo) const;
+
+        const T* splitters_;
+        int      k_;
+        int      levels_;
+        std::vector<unsigned long long> tree_;    // 1-based Eytzinger order
+        std::vector<unsigned long long> prefix_;  // sorted splitter prefixes
+    };
+
+}//end namespace
+
+#include "splitterTree.txx"
+
+#endif
+
@@ -0,0 +1,94 @@
+
+/**
+  @file splitterTree.txx
+  @brief Definitions of the SplitterTree class.
+ */
+
+#include <algorithm>
+#include "cpuDispatch.h"
+
+namespace seq {
+
+  template <typename T>
+    SplitterTree<T>::SplitterTree(const T* splitters, int k) {
+      build(splitters, k);
+    }
+
+  template <typename T>
+    void SplitterTree<T>::build(const T* splitters, int k) {
+      splitters_ = splitters;
+      k_         = k;
+      levels_    = 0;
+
+      if(!KeyPrefix<T>::enabled) return;
+
+      while( ((1 << levels_) - 1) < k ) levels_++;
+
+      // pad to a complete tree with max prefixes (never < any key)
+      const size_t N = (1 << levels_) - 1;
+      prefix_.assign(N, ~0ULL);
+      for(int i=0; i<k; i++) prefix_[i] = KeyPrefix<T>::get(splitters[i]);
+
+      // in-order fill of the implicit tree (path depth <= levels_)
+      tree_.resize(N+1);
+      size_t pos = 0, node = 1;
+      size_t stack[64];
+      int    top = 0;
+      while(pos < N) {
+        while(node <= N) { stack[top++] = node; node = 2*node; }
+        node = stack[--top];
+        tree_[node] = prefix_[pos++];
+        node = 2*node + 1;
+      }
+    }
+
+  template <typename T>
+    inline int SplitterTree<T>::resolve(const T & key, unsigned long long prefix, int lo) const {
+      // lo = # splitters with a smaller prefix; walk the (rare) ties
+      if(lo > k_) lo = k_;
+      while( (lo < k_) && (prefix_[lo] == prefix) && !(key < splitters_[lo]) ) lo++;
+      return lo;
+    }
+
+  template <typename T>
+    int SplitterTree<T>::classify(const T & key) const {
+      if(!KeyPrefix<T>::enabled)
+        return std::upper_bound(splitters_, splitters_+k_, key) - splitters_;
+
+      const unsigned long long p = KeyPrefix<T>::get(key);
+      const unsigned long long* t = &tree_[0];
+      size_t i = 1;
+      for(int l=0; l<levels_; l++) i = 2*i + (t[i] < p);
+      return resolve(key, p, (int)(i - (1 << levels_)));
+    }
+
+  template <typename T>
+    void SplitterTree<T>::classify(const T* keys, size_t n, int* out) const {
+      if(!KeyPrefix<T>::enabled) {
+        for(size_t j=0; j<n; j++)
+          out[j] = std::upper_bound(splitters_, splitters_+k_, keys[j]) - splitters_;
+        return;
+      }
+
+      // descend a batch of keys level by level with the kernel bound
+      // for this CPU (interleaved scalar walks or SIMD gathers)
+      const int B = 64;
+      const splitter_classify_fn descend = simd_kernels().classify;
+      const unsigned long long* t = &tree_[0];
+      unsigned long long p[B];
+      size_t i[B];
+
+      for(size_t b=0; b<n; b+=B) {
+        const int m = (n-b < (size_t)B) ? (int)(n-b) : B;
+
+        for(int j=0; j<m; j++) p[j] = KeyPrefix<T>::get(keys[b+j]);
+
+        descend(t, levels_, p, m, i);
+
+        for(int j=0; j<m; j++)
+          out[b+j] = resolve(keys[b+j], p[j], (int)(i[j] - (1 << levels_)));
+      }
+    }
+
+}//end namespace
+
@@ -0,0 +1,127 @@
+
+// Checks the (key prefix, index) merge kernels of avx/keyIndexMerge.h
+// against std::merge. Every level supported by the CPU is bound through
+// seq::simd_select() and run on random inputs with short tails (fewer
+// tuples than the network width), heavy prefix ties and prefixes with
+// the high bit set. Returns non-zero on any mismatch.
+//
+//   make test && ./bin/keyIndexMergeTest
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include "cpuDispatch.h"
+
+struct KeyIndexLessFull {
+  bool operator() (KeyIndex const &a, KeyIndex const &b) const {
+    return (a.prefix < b.prefix) || ( (a.prefix == b.prefix) && (a.indx < b.indx) );
+  }
+};
+
+static unsigned long long randomPrefix(int range, int shift, bool highBit)
+{
+  unsigned long long p = (unsigned long long)(rand() % range) << shift;
+  return highBit ? (p | 0x8000000000000000ULL) : p;
+}
+
+// output must be ordered by prefix and hold the same tuples as the reference
+static bool matches(std::vector<KeyIndex> out, std::vector<KeyIndex> ref)
+{
+  KeyIndexPrefixLess lt;
+  if(!std::is_sorted(out.begin(),out.end(),lt))
+    return(false);
+
+  KeyIndexLessFull full;
+  std::sort(out.begin(),out.end(),full);
+  std::sort(ref.begin(),ref.end(),full);
+
+  for(size_t i=0;i<out.size();i++)
+    if( (out[i].prefix != ref[i].prefix) || (out[i].indx != ref[i].indx) )
+      return(false);
+
+  return(true);
+}
+
+static long testLevel(int level, int numTrials)
+{
+  const int MAX_LEN = 70;		// a few network widths, plus short tails
+  KeyIndexPrefixLess lt;
+  long failures = 0;
+
+  for(int it=0;it<numTrials;it++)
+    {
+      int na = rand() % MAX_LEN;
+      int nb = rand() % MAX_LEN;
+
+      if(it % 4 == 0)			// one side shorter than any network width
+	na = rand() % 8;
+
+      int  range   = (it % 3 == 0) ? 4 : ( (it % 3 == 1) ? 1000 : 2000000000 );
+      int  shift   = (it % 2) ? 33 : 0;
+      bool highBit = (it % 5 == 0);
+
+      std::vector<KeyIndex> a(na), b(nb);
+
+      for(int i=0;i<na;i++)
+	{
+	  a[i].prefix = randomPrefix(range,shift,highBit);
+	  a[i].indx   = i;
+	}
+      for(int i=0;i<nb;i++)
+	{
+	  b[i].prefix = randomPrefix(range,shift,false);
+	  b[i].indx   = MAX_LEN + i;
+	}
+
+      std::sort(a.begin(),a.end(),lt);
+      std::sort(b.begin(),b.end(),lt);
+
+      std::vector<KeyIndex> ref(na+nb), out(na+nb);
+      std::merge(a.begin(),a.end(),b.begin(),b.end(),ref.begin(),lt);
+
+      seq::simd_kernels().mergeKeyIndex(a.data(),a.data()+na,b.data(),b.data()+nb,out.data());
+
+      if(!matches(out,ref))
+	{
+	  if(failures < 5)
+	    printf("  FAIL: level %i, na = %i, nb = %i, range = %i\n",level,na,nb,range);
+	  failures++;
+	}
+    }
+
+  return(failures);
+}
+
+int main(int argc, char *argv[])
+{
+  const int numTrials = (argc > 1) ? atoi(argv[1]) : 20000;
+  const int maxLevel  = seq::simd_detect();
+  long failures = 0;
+
+  srand(12345);
+
+  for(int level=seq::SIMD_SCALAR;level<=seq::SIMD_AVX512;level++)
+    {
+      if(level > maxLevel)
+	{
+	  printf("keyIndexMerge: level %i not supported by this CPU, skipped\n",level);
+	  continue;
+	}
+
+      seq::simd_select(level);
+      if(seq::simd_kernels().level != level)
+	{
+	  printf("keyIndexMerge: level %i not compiled in, skipped\n",level);
+	  continue;
+	}
+
+      long f = testLevel(level,numTrials);
+      printf("keyIndexMerge: %-7s %i trials, %li failures\n",seq::simd_kernels().name,numTrials,f);
+      failures += f;
+    }
+
+  seq::simd_select(seq::SIMD_AUTO);
+
+  return( (failures == 0) ? 0 : 1 );
+}
@@ -32,13 +32,6 @@
 // Operates on SORT_COMM.
 // --------------------------------------------------------------------
 
-struct shmem_finalsort_sync
-{
-  boost::interprocess::interprocess_mutex     mutex;
-  boost::interprocess::interprocess_condition condSortFinished;
-  int activeSorts;
-};
-
 void sortio_Class::manageSortProcess()
 {
   assert(initialized_);
@@ -47,7 +40,7 @@ void sortio_Class::manageSortProcess()
     return;
 
   int messageSize;
-  std::vector<sortRecord > sortBuffer;
+  std::vector<sortRecord> &sortBuffer = arena_.records;	// <-- capacity reused by every pass
 
   if(!isSortTask_)
     return;
@@ -70,7 +63,10 @@ void sortio_Class::manageSortProcess()
     {
       void *addr2 = regionSort.get_address();
       sortSync = new (addr2) shmem_finalsort_sync;
-      sortSync->activeSorts = 0;
+      sortSync->activeBytes = 0;
+      sortSync->pinnedBytes = 0;
+      sortSync->nextBin     = 0;
+      sortSync->spareCores  = 0;
     } 
   else
     sortSync = static_cast<shmem_finalsort_sync*>(regionSort.get_address());
@@ -128,6 +124,18 @@ void sortio_Class::manageSortProcess()
   const size_t binningWaterMark = 1*numSortHosts_;
   //  const size_t binningWaterMark = numSortHosts_/10;
 
+  // optional byte-based binning threshold: number of transfer buffers
+  // (summed across a BIN group) which provides approximately
+  // target_run_size_mbs of data per host for each local run
+
+  int runThreshold = 0;
+
+  if(targetRunSizeMBs_ > 0)
+    {
+      size_t targetBytes = (size_t)targetRunSizeMBs_*1024*1024*numSortHosts_;
+      runThreshold = std::max((size_t)1,targetBytes/messageSize);
+    }
+
   char tmpFilename[1024];	     // location for tmp file
   std::vector<std::pair <sortRecord,DendroIntL> >  sortBinsSkewed;
   std::vector<sortRecord> sortBins;  // binning buckets
@@ -140,6 +148,9 @@ void sortio_Class::manageSortProcess()
     {
       grvy_printf(INFO,"[sortio][SORT] Message transfer size = %i\n",messageSize);
       grvy_printf(INFO,"[sortio][SORT] Number of records     = %i\n",numRecordsPerXfer);
+      if(runThreshold > 0)
+	grvy_printf(INFO,"[sortio][SORT] Binning threshold     = %i files (%i MBs/host)\n",
+		    runThreshold,targetRunSizeMBs_);
     }
 
   // Start main processing loop; check for data from XFER tasks via
@@ -157,6 +168,47 @@ void sortio_Class::manageSortProcess()
   if(isMasterSort_)
     grvy_printf(INFO,"[sortio][SORT/IPC][%.4i] Beginning main processing loop \n",sortRank_);
 
+  // Each binning task appends all of its passes to one persistent
+  // file per bucket (basename_%03d.dat) rather than one file per
+  // bucket per pass
+
+  par::BucketWriter binWriter;
+
+  if( (sortMode_ > 1) && (binNum_ >= 0) )
+    {
+      const size_t writeBufSize = 4*1024*1024;
+      const size_t maxQueued    = (size_t)asyncWriteMBs_*1024*1024;
+
+      sprintf(tmpFilename,"%s/bins/proc%.4i_g%.2i",tmpDir_.c_str(),binRanks_[binNum_],binNum_);
+      grvy_check_file_path(tmpFilename);
+      binWriter.open(tmpFilename,numSortBins_,writeBufSize,maxQueued);
+      binWriter.setSortedRuns(finalMerge_ != 0);
+      binWriter.setMemoryLimit((size_t)binMemMBs_*1024*1024/numSortGroups_);
+
+      // size the binning arena once for a full pass (the pass threshold
+      // spread over the BIN group plus one transfer of slack) so that
+      // passes neither grow sortBuffer nor allocate partition and
+      // bucket storage; run buffers are pooled for the runs that may be
+      // queued for the background writer
+
+      int binSize;
+      MPI_Comm_size(BIN_COMMS_[binNum_],&binSize);
+
+      const size_t passFiles   = (runThreshold > 0) ? (size_t)runThreshold : binningWaterMark;
+      const size_t passRecords = ((passFiles + binSize - 1)/binSize + 1)*numRecordsPerXfer;
+      const size_t runRecords  = passRecords/numSortBins_ + 1;
+
+      int numRunBuffers = 1;
+      if(binWriter.isAsync())
+	numRunBuffers += std::min((size_t)numSortBins_,maxQueued/(runRecords*sizeof(sortRecord)));
+
+      arena_.reserve(passRecords,std::max(4*binSize,numSortBins_+1));
+      arena_.runs.prefill(numRunBuffers,runRecords);
+
+      grvy_printf(DEBUG,"[sortio][SORT][%.4i] Binning arena = %zi MBs (+ %i run buffers of %zi MBs)\n",
+		  sortRank_,arena_.bytes()/(1024*1024),numRunBuffers,runRecords*sizeof(sortRecord)/(1024*1024));
+    }
+
   MPI_Barrier(SORT_COMM);
 
   gt.BeginTimer("Sort/Recv");
@@ -166,6 +218,7 @@ void sortio_Class::manageSortProcess()
 
   int fileOnHandFirst = 0;
   int bufSizeAvail    = 0;
+  double timeStart    = MPI_Wtime();
 
   if(isBinTask_[0])
     while(true)
@@ -173,20 +226,24 @@ void sortio_Class::manageSortProcess()
 	int localData    = 0;
 	int globalData   = 0;
 
-	bool isNewDataAvail = false;
-	{
-	  scoped_lock<interprocess_mutex> lock(syncFlags2->mutex);
-	  isNewDataAvail = !syncFlags2->isReadyForNewData;
+	// sleep until data lands in the IPC buffer (rather than spinning)
 
-	  if(isNewDataAvail)
-	    {
-	      bufSizeAvail = syncFlags2->bufSizeAvail;
-	      assert( (bufSizeAvail%numRecordsPerXfer) == 0);
-	    }
-	}
+	bool isNewDataAvail = waitForIpcData(syncFlags2,bufSizeAvail);
+
+	if(isNewDataAvail)
+	  assert( (bufSizeAvail%numRecordsPerXfer) == 0);
 
 	if(isNewDataAvail)	// indicates data available
 	  {
+	    // the file count is known up front: post the reduction first
+	    // and copy the records out while it is in flight
+
+	    localData    = bufSizeAvail / (numRecordsPerXfer*sizeof(sortRecord));	      
+	    //localData    = 1;
+
+	    MPI_Request request;
+	    assert (MPI_Iallreduce(&localData,&globalData, 1,MPI_INT,MPI_SUM,BIN_COMMS_[0],&request) == MPI_SUCCESS);
+
 	    if(sortMode_ > 1)
 	      {
 		grvy_printf(INFO,"[sortio][SORT/IPC][%.4i] found data to copy\n",sortRank_);
@@ -203,8 +260,6 @@ void sortio_Class::manageSortProcess()
 
 	    grvy_printf(DEBUG,"[sortio][SORT/IPC][%.4i] re-enabling buffer (iter =%i)\n",sortRank_,count);
 
-	    localData    = bufSizeAvail / (numRecordsPerXfer*sizeof(sortRecord));	      
-	    //localData    = 1;
 	    syncFlags[0] = 0;
 
 	    {
@@ -213,14 +268,20 @@ void sortio_Class::manageSortProcess()
 	      syncFlags2->condEmpty.notify_one();
 	    }
 
-	    assert (MPI_Allreduce(&localData,&globalData, 1,MPI_INT,MPI_SUM,BIN_COMMS_[0]) == MPI_SUCCESS);
+	    waitForRequest(&request);
 	
 	    numFilesReceived += globalData;
+	    fileOnHandFirst  += globalData;
 
 	    int numRecordsLocal  = sortBuffer.size();
 	    int numRecordsGlobal = 0;
 
-	    if( (globalData >= binningWaterMark) )
+	    bool startBinning = (globalData >= binningWaterMark);
+
+	    if(runThreshold > 0)
+	      startBinning = (fileOnHandFirst >= runThreshold) || (numFilesReceived >= numFilesTotal_);
+
+	    if(startBinning)
 	      {
 		if(sortMode_ > 1)
 		  {
@@ -232,7 +293,7 @@ void sortio_Class::manageSortProcess()
 				  sortRank_,sortBuffer.size());
 
 		    gt.BeginTimer("Local Sort");
-		    omp_par::merge_sort(&sortBuffer[0],&sortBuffer[sortBuffer.size()]);
+		    omp_par::local_sort(&sortBuffer[0],&sortBuffer[sortBuffer.size()]);
 		    gt.EndTimer("Local Sort");
 
 		    gt.BeginTimer("Global Binning");
@@ -252,11 +313,6 @@ void sortio_Class::manageSortProcess()
 		    
 		    outputCount = 0; // first write
 
-		    sprintf(tmpFilename,"%s/%i/proc%.4i",tmpDir_.c_str(),outputCount,binRanks_[0]);
-		    //sprintf(tmpFilename,"/tmp/utsort/%i/proc%.4i",outputCount,binRanks_[0]);
-		    grvy_printf(DEBUG,"[%.4i] saving to file %s\n",sortRank_,tmpFilename);
-		    
-		    grvy_check_file_path(tmpFilename);
 		    grvy_printf(DEBUG,"[sortio][SORT][%.4i]: Size of sortBuffer for bucket = %zi\n",sortRank_,
 				sortBuffer.size());
 
@@ -265,12 +321,15 @@ void sortio_Class::manageSortProcess()
 
 		    if(useSkewSort_)
 		      writeCounts = par::bucketDataAndWriteSkewed(sortBuffer,sortBinsSkewed,
-								  tmpFilename,BIN_COMMS_[0]);
+								  binWriter,BIN_COMMS_[0],binRebalance_,&arena_);
 		    else
-		      writeCounts = par::bucketDataAndWrite(sortBuffer,sortBins,
-							    tmpFilename,BIN_COMMS_[0]);
+		      writeCounts = par::bucketDataAndWrite(sortBuffer,sortBins,	// <-- sorted above
+							    binWriter,BIN_COMMS_[0],true,binRebalance_,&arena_);
 
 		    gt.EndTimer("Bucket and Write");	    
+
+		    if(!binRebalance_)
+		      reportBucketImbalance(writeCounts,BIN_COMMS_[0],outputCount);
 		    
 		    assert(writeCounts.size() == numSortBins_ );
 		    tmpWriteSizes.push_back(writeCounts);
@@ -283,6 +342,12 @@ void sortio_Class::manageSortProcess()
 	  }
       }
 
+  if(isBinTask_[0])
+    {
+      binActiveTime_ += MPI_Wtime() - timeStart;
+      binActivations_++;
+    }
+
   MPI_Barrier(SORT_COMM);
   gt.EndTimer("Sort/Recv");
 
@@ -391,7 +456,13 @@ void sortio_Class::manageSortProcess()
 	break;
 
       if(numSortGroups_ > 1)
-	numFilesReceived = waitForActivation();
+	{
+	  timeStart        = MPI_Wtime();
+	  numFilesReceived = waitForActivation();
+	  binIdleTime_    += MPI_Wtime() - timeStart;
+	}
+
+      timeStart = MPI_Wtime();
 
       // tear-down procedure, notify remaining bin groups that we have
       // processed all files, we send a negative count here and count
@@ -427,11 +498,19 @@ void sortio_Class::manageSortProcess()
       //int threshold = numSortHosts_;
       int threshold = numSortHosts_/2;
       
-      if(numFilesReceived > (numFilesTotal_ - numSortHosts_) )
+      if(runThreshold > 0)
+	{
+	  threshold = runThreshold;
+	  if(numFilesReceived > (numFilesTotal_ - runThreshold) )
+	    threshold = numFilesTotal_ - numFilesReceived;
+	}
+      else if(numFilesReceived > (numFilesTotal_ - numSortHosts_) )
 	threshold = numFilesTotal_ - numFilesReceived;
 
       // loop until this BIN group has sufficient data available
 
+      const int IPC_LIVENESS_MS = 100;
+
       while(true)
 	{
 	  if(isActiveMaster)
@@ -447,18 +526,32 @@ void sortio_Class::manageSortProcess()
 	  int dataLocal [2];
 	  int dataGlobal[2];
 
-	  bool isNewDataAvail = false;
+	  // join the group reduction once local IPC data lands, or after
+	  // a coarse liveness timeout so that the group still learns of
+	  // data landing on other hosts; an idle group thus reduces a few
+	  // times a second rather than spinning. A rank with data may wait
+	  // in the reduction for idle peers to time out.
 
-	  {
-	    scoped_lock<interprocess_mutex> lock(syncFlags2->mutex);
-	    isNewDataAvail = !syncFlags2->isReadyForNewData;
+	  bool isNewDataAvail = waitForIpcData(syncFlags2,bufSizeAvail,IPC_LIVENESS_MS);
 
-	    if(isNewDataAvail)
-	      {
-		bufSizeAvail = syncFlags2->bufSizeAvail;
-		assert( (bufSizeAvail%numRecordsPerXfer) == 0);
-	      }
-	  }
+	  if(isNewDataAvail)
+	    {
+	      assert( (bufSizeAvail%numRecordsPerXfer) == 0);
+
+	      const size_t newRecords = (sortMode_ > 1) ? bufSizeAvail/sizeof(sortRecord) : 0;
+
+	      localData    = bufSizeAvail / (numRecordsPerXfer*sizeof(sortRecord));	      
+	      //	      localData    = 1;
+	      localSize    = (sortBuffer.size() + newRecords)/numRecordsPerXfer;
+	    }
+
+	  dataLocal[0] = localData;
+	  dataLocal[1] = localSize;
+
+	  // post the reduction first and copy the records out while it is in flight
+
+	  MPI_Request request;
+	  assert (MPI_Iallreduce(dataLocal,dataGlobal,2,MPI_INT,MPI_SUM,BIN_COMMS_[binNum_],&request) == MPI_SUCCESS);
 	    
 	  if(isNewDataAvail)
 	    {
@@ -476,10 +569,6 @@ void sortio_Class::manageSortProcess()
 	      
 	      grvy_printf(DEBUG,"[sortio][SORT/IPC][%.4i] re-enabling buffer (iter =%i)\n",sortRank_,count);
 
-	      localData    = bufSizeAvail / (numRecordsPerXfer*sizeof(sortRecord));	      
-	      //	      localData    = 1;
-	      localSize    = sortBuffer.size()/numRecordsPerXfer;
-
 	      syncFlags[0] = 0;
 
 	      try 
@@ -496,10 +585,7 @@ void sortio_Class::manageSortProcess()
 
 	    }
 
-	  dataLocal[0] = localData;
-	  dataLocal[1] = localSize;
-
-	  assert (MPI_Allreduce(dataLocal,dataGlobal,2,MPI_INT,MPI_SUM,BIN_COMMS_[binNum_]) == MPI_SUCCESS);
+	  waitForRequest(&request);
 
 	  globalData        = dataGlobal[0];
 	  numFilesReceived += globalData;
@@ -529,11 +615,6 @@ void sortio_Class::manageSortProcess()
 
 		  outputCount = iterCount*numSortGroups_ + binNum_;
 
-		  sprintf(tmpFilename,"%s/%i/proc%.4i",tmpDir_.c_str(),outputCount,binRanks_[binNum_]);
-		  //sprintf(tmpFilename,"/tmp/utsort/%i/proc%.4i",outputCount,binRanks_[binNum_]);
-		  grvy_printf(DEBUG,"[%.4i] saving to file %s\n",sortRank_,tmpFilename);
-		  
-		  grvy_check_file_path(tmpFilename);
 		  grvy_printf(DEBUG,"[sortio][SORT][%.4i]: Size of sortBuffer for bucket = %zi\n",sortRank_,
 			      sortBuffer.size());
 
@@ -542,13 +623,16 @@ void sortio_Class::manageSortProcess()
 		  gt.BeginTimer("Bucket and Write");
 		  if(useSkewSort_)
 		    writeCounts = par::bucketDataAndWriteSkewed(sortBuffer,sortBinsSkewed,
-								tmpFilename,BIN_COMMS_[binNum_]);
+								binWriter,BIN_COMMS_[binNum_],binRebalance_,&arena_);
 		  else
 		    writeCounts = par::bucketDataAndWrite(sortBuffer,sortBins,
-							  tmpFilename,BIN_COMMS_[binNum_]);
+							  binWriter,BIN_COMMS_[binNum_],false,binRebalance_,&arena_);
 							  
 		  gt.EndTimer("Bucket and Write");	    
 
+		  if(!binRebalance_)
+		    reportBucketImbalance(writeCounts,BIN_COMMS_[binNum_],outputCount);
+
 		  if(writeCounts.size() != numSortBins_)
 		    printf("[%.4i] expected %i, but got %zi\n",sortRank_,numSortBins_,writeCounts.size());
 		  assert(writeCounts.size() == numSortBins_ );
@@ -584,10 +668,30 @@ void sortio_Class::manageSortProcess()
 
       iterCount++;
 
+      binActiveTime_ += MPI_Wtime() - timeStart;
+      binActivations_++;
+
     } // end main loop
 
+  // complete any outstanding ring activation
+
+  if(binCycleReq_ != MPI_REQUEST_NULL)
+    assert( MPI_Wait(&binCycleReq_,MPI_STATUS_IGNORE) == MPI_SUCCESS);
+
   gt.EndTimer("Sort/Recv");
 
+  // flush remaining write-behind data and save the run index
+
+  if(binWriter.isOpen())
+    {
+      gt.BeginTimer("Bucket and Write");
+      if(binWriter.isAsync())
+	grvy_printf(DEBUG,"[sortio][BIN][%.4i] Async writer stalled for %.3f secs\n",sortRank_,
+		    binWriter.stallTime());
+      binWriter.close();
+      gt.EndTimer("Bucket and Write");
+    }
+
   sortBuffer.clear();
   sortBins.clear();
 
@@ -596,6 +700,8 @@ void sortio_Class::manageSortProcess()
 
   MPI_Barrier(SORT_COMM);
 
+  summarizeBinGroups();
+
   // let xfer receiving tasks know we have all the goods
 
   {
@@ -677,232 +783,241 @@ void sortio_Class::manageSortProcess()
       
       int outputLocal  = tmpWriteSizes.size();
       int outputCount  = 0;
-      const int tag1   = 4200;
-      const int tag2   = 42000;
 
       if(isMasterSort_)
 	{
 	  grvy_printf(INFO,"[sortio][FINALSORT] Total # distinct outputs (per bin) = %i\n",maxDirNum);
+	  grvy_printf(INFO,"[sortio][FINALSORT] Total # bucket files (per bin)     = %i\n",numSortGroups_);
 	  fflush(NULL);
 	}
 
       long int numRecordsReadFromTmp = 0;
-      //const int maxSortingAtOnce     = 1;   // run1/run2
-      const int maxSortingAtOnce     = numMaxFinalSorters_;
 
-      if(isMasterSort_)
-	  sortSync->activeSorts = 0;
+      const int numBinGroups = numSortGroups_;  // <-- one bucket file per bin group on each host
 
       numSortGroups_ = numFinalSortGroups_; // <-- potentially limit final sort groups
 
+      // binned runs still held in memory move to the host task that
+      // owns their bin in the final sort
+
+      std::vector< std::vector<sortRecord> > memBins;
+      std::vector< std::vector<DendroIntL> > memRuns;
+
+      if(binMemMBs_ > 0)
+	{
+	  gt.BeginTimer("Memory Run Exchange");
+	  exchangeMemRuns(binWriter,memBins,memRuns);
+	  gt.EndTimer("Memory Run Exchange");
+
+	  // the gathered runs are resident from here on: charge them
+	  // against the final sort budget until their bin takes them
+
+	  for(int ibin=0;ibin<numSortBins_;ibin++)
+	    pinFinalSortMem(sortSync,memBins[ibin].size()*sizeof(sortRecord),true);
+	}
+
       //      if(isBinTask_[0])
 	{
+	  // The final sort is pipelined per task: while bin i is being
+	  // sorted (collective over its BIN_COMM), the next bin owned by
+	  // this task is read and the previous one is written by a
+	  // background thread. Bins are admitted in order on each host
+	  // and charged against the final_sort_mem_mbs budget from the
+	  // start of their read until their write completes.
 
-	  bool first_entry  = true;
-	  bool first_entry2 = true;
+	  std::vector<int> myBins;
 
 	  for(int ibin=0;ibin<numSortBins_;ibin++)
+	    if(isBinTask_[ibin % numSortGroups_])
+	      myBins.push_back(ibin);
+
+	  // sort kernels run on a persistent work-stealing pool; with
+	  // task_pool = 2 its guest workers also borrow the cores other
+	  // sort tasks on this host donate while they are not sorting
+
+	  if(taskPool_ > 0)
 	    {
+	      omp_par::task_pool().start(numSortThreads_,(taskPool_ == 2) ? numSortThreads_ : 0);
+	      if(taskPool_ == 2)
+		omp_par::task_pool().shareCores(&sortSync->spareCores);
+	    }
+
+	  bool coresDonated = false;
 
-	      // define current master group
+	  // bins cycle through the arena's record buffer, the read/write
+	  // stage buffers and the arena's sort workspace. Without a host
+	  // memory budget their capacity is kept from bin to bin; with one,
+	  // memory is returned along with each bin's reservation since
+	  // retained buffers are not charged against the budget.
 
+	  const bool recycle = (finalSortMemMBs_ == 0);
+	  std::vector<sortRecord> &binnedData = arena_.records;
+
+	  arena_.runs.clear();
+	  if(!recycle)
+	    arena_.release();
+
+	  FinalBinStage readStage, writeStage;
+
+	  readStage.active  = writeStage.active  = false;
+	  readStage.recycle = writeStage.recycle = recycle;
+	  readStage.sortio  = writeStage.sortio  = this;
+	  readStage.sync    = writeStage.sync    = sortSync;
+
+	  for(size_t j=0;j<myBins.size();j++)
+	    {
+	      int ibin      = myBins[j];
 	      int sortGroup = ibin % numSortGroups_;
 
-	      if(!isBinTask_[sortGroup])
-		continue;
-	      
-	      // non-master tasks wait for notification to proceed
+	      std::vector<std::string> binFiles;
+	      std::vector<DendroIntL> binRuns;	// sorted run lengths (final_merge only)
+	      size_t binReserved;
+	      size_t memBinBytes = (binMemMBs_ > 0) ? memBins[ibin].size()*sizeof(sortRecord) : 0;
 
-	      if(numSortGroups_ > 1)
-		if(!first_entry || (first_entry && sortGroup != 0) )
-		  {
-		    MPI_Status status;
-		    int activate;
-		    int recvRank  = sortRank_ -1;
-		    
-		    if(sortGroup == 0)
-		      recvRank = sortRank_ + (numSortGroups_ - 1);
-		    
-		    if(binRanks_[sortGroup] == 0)
-		      grvy_printf(INFO,"[sortio][FINALSORT] Group %i waiting to begin local read...\n",sortGroup);
-		    
-		    assert( MPI_Recv(&activate,1,MPI_INT,recvRank,tag1+ibin,SORT_COMM,&status) == MPI_SUCCESS);
-		  }
+	      finalBinFiles(ibin,sortGroup,numBinGroups,binFiles,binRuns);
 
-	      first_entry = false;
-		   
-	      if(isBinTask_[sortGroup])
+	      // (1) obtain data for this bin: either prefetched in the
+	      // background or read now
+
+	      gt.BeginTimer("Read Temp Data");
+
+	      if(readStage.active && (readStage.ibin == ibin))
+		{
+		  waitFinalStage(readStage);
+		  binnedData.swap(readStage.data);
+		  binReserved = readStage.reserved;
+		}
+	      else
 		{
+		  binReserved = 2*(tmpFilesBytes(binFiles) + memBinBytes);	// <-- data + sort workspace
+
 		  if(binRanks_[sortGroup] == 0)
-		    grvy_printf(INFO,"[sortio][FINALSORT] Group %i starting read for bin %i of %i...\n",sortGroup,
-				ibin,numSortBins_);
+		    grvy_printf(INFO,"[sortio][FINALSORT] Group %i waiting to begin read for bin %i...\n",
+				sortGroup,ibin);
 
-		  // allocate buffer space for reading in tmp data (max size computed above).
+		  reserveFinalSortMem(sortSync,ibin,binReserved,true);
+		  readTmpFiles(binFiles,binnedData);
+		}
 
-		  //std::vector<sortRecord> binnedData(maxPerBin*numSortBins_);
+	      gt.EndTimer("Read Temp Data");
 
-		  //std::vector<sortRecord> singleRecord(1);
-		  sortRecord singleRecord;
-      
-		  int recordsPerBinLocal = 0;
-		  int recordsPerBinMax   = 0;
-		  size_t startIndex      = 0;
+	      // append runs which never left memory
 
-		  const int alloc_chunk  = 256*1000*1000/sizeof(singleRecord);
-		  std::vector<sortRecord> binnedData(alloc_chunk);
+	      if(binMemMBs_ > 0)
+		{
+		  binnedData.insert(binnedData.end(),memBins[ibin].begin(),memBins[ibin].end());
+		  binRuns.insert(binRuns.end(),memRuns[ibin].begin(),memRuns[ibin].end());
+		  std::vector<sortRecord>().swap(memBins[ibin]);
+		  pinFinalSortMem(sortSync,memBinBytes,false);	// <-- now part of binReserved
+		}
 
-		  gt.BeginTimer("Read Temp Data");
-	      
-		  int myCount = 0;
-	      
-		  for(int iter=0;iter<=maxDirNum;iter++)
-		    {
-		      sprintf(tmpFilename,"%s/%i/proc%.4i_%.3i.dat",tmpDir_.c_str(),iter,binRanks_[sortGroup],ibin);
-		      //sprintf(tmpFilename,"/tmp/utsort/%i/proc%.4i_%.3i.dat",iter,binRanks_[sortGroup],ibin);
-
-		      FILE *fp = fopen(tmpFilename,"rb");
-		      if(fp == NULL)
-			grvy_printf(ERROR,"[sortio][FINALSORT][%.4i] Unable to access file %s\n",
-				    binRanks_[sortGroup],tmpFilename);
-		      
-		      assert(fp != NULL);
-		      grvy_printf(DEBUG,"[sortio][FINALSORT][%.4i] Group %i Read in file %s\n",
-				  binRanks_[sortGroup],sortGroup,tmpFilename);
-		  
-		      myCount = 0;
-		      while(fread(&binnedData[startIndex],sizeof(sortRecord),1,fp) == 1)
-			{
-			  binnedData.push_back(singleRecord);
-			  startIndex++;
-			  //assert(startIndex < binnedData.size());
-			  if(startIndex == binnedData.size())
-			    binnedData.resize(binnedData.size()+alloc_chunk);
-			  myCount++;
-			}
-		      
-		      if(!feof(fp))
-			grvy_printf(ERROR,"[sortio][FINALSORT][%.4i] Warning koomie: missed eof for %s\n",
-				    binRanks_[sortGroup],tmpFilename);
-
-		      //assert(feof(fp));
-
-		      fclose(fp);
-
-		      numRecordsReadFromTmp += myCount;
-
-		    } // end loop over maxDirNum
-
-		  gt.EndTimer("Read Temp Data");
-
-		  // notifiy next sort group to commence read...
-
-		  if(numSortGroups_ > 1)
-		    {
-		      int destRank = sortRank_ + 1;
-		      int notify = 0;
-		      if(sortGroup == numSortGroups_ - 1)
-			destRank = sortRank_ - (numSortGroups_ - 1);
-		      
-		      if(binRanks_[sortGroup] == 0)
-			grvy_printf(INFO,"[sortio][FINALSORT] Group %i notifying next group to begin read...\n",
-				    sortGroup);
-		      fflush(NULL);
-
-		      if(ibin < (numSortBins_-1))
-			assert(MPI_Send(&notify,1,MPI_INT,destRank,tag1+ibin+1,SORT_COMM) == MPI_SUCCESS);
-		    }
+	      numRecordsReadFromTmp += binnedData.size();
 
-		  // do final sort - stall if too many are currently
-		  // active (so we don't run out of memory)
+	      if(binRanks_[sortGroup] == 0)
+		grvy_printf(INFO,"[sortio][FINALSORT] Group %i read bin %i of %i (%zi records)\n",sortGroup,
+			    ibin,numSortBins_,binnedData.size());
 
-		  {
-		    scoped_lock<interprocess_mutex> lock(sortSync->mutex);
+	      // (2) prefetch the next bin if it can be admitted now
 
-		    if(binRanks_[sortGroup] == 0)
-		      grvy_printf(INFO,"[sortio][FINALSORT] Group %i lock granted (%i active of %i max)\n",sortGroup,
-				  sortSync->activeSorts,maxSortingAtOnce);
+	      if(j+1 < myBins.size())
+		{
+		  readStage.ibin    = myBins[j+1];
+		  readStage.outFile = "";
+		  std::vector<DendroIntL> nextRuns;
 
-		    if( (sortSync->activeSorts +1 ) > maxSortingAtOnce)
-		      {
-			if(binRanks_[sortGroup] == 0)
-			  grvy_printf(INFO,"[sortio][FINALSORT] Group %i stalling.. (%i active of %i max)\n",sortGroup,
-				      sortSync->activeSorts,maxSortingAtOnce);
+		  finalBinFiles(readStage.ibin,sortGroup,numBinGroups,readStage.files,nextRuns);
+		  readStage.reserved = 2*tmpFilesBytes(readStage.files);
+		  if(binMemMBs_ > 0)
+		    readStage.reserved += 2*memBins[readStage.ibin].size()*sizeof(sortRecord);
 
-			sortSync->condSortFinished.wait(lock);
+		  if(reserveFinalSortMem(sortSync,readStage.ibin,readStage.reserved,false))
+		    startFinalStage(readStage);
+		}
 
-			if(binRanks_[sortGroup] == 0)
-			  grvy_printf(INFO,"[sortio][FINALSORT] Group %i stall complete (%i active of %i max)\n",
-				      sortGroup,sortSync->activeSorts,maxSortingAtOnce);
-				    
-		      }
+	      // (3) sort
 
-		    sortSync->activeSorts++;
+	      fflush(NULL);
 
-		    if(binRanks_[sortGroup] == 0)
-		      grvy_printf(INFO,"[sortio][FINALSORT] Group %i starting sort(%i active of %i max)\n",sortGroup,
-				  sortSync->activeSorts,maxSortingAtOnce);
-		  }
+	      omp_set_num_threads(numSortThreads_);
 
-		  int globalRead;
-		  binnedData.resize(startIndex);
+	      if(coresDonated)
+		{
+		  omp_par::task_pool().reclaim(numSortThreads_);
+		  coresDonated = false;
+		}
 
-		  fflush(NULL);
+	      MPI_Barrier(BIN_COMMS_[sortGroup]);
+	      gt.BeginTimer("Final Sort");
 
-		  omp_set_num_threads(numSortThreads_);
+	      if(binRanks_[sortGroup] == 0)
+		grvy_printf(INFO,"[sortio][FINALSORT] Group %i calling final sort with input size = %zi\n",
+			    sortGroup,binnedData.size());
 
-		  MPI_Barrier(BIN_COMMS_[sortGroup]);
-		  gt.BeginTimer("Final Sort");
+	      fflush(NULL);
 
-		  if(binRanks_[sortGroup] == 0)
-		    grvy_printf(INFO,"[sortio][FINALSORT] Group %i calling final sort with input size = %zi\n",
-				sortGroup,binnedData.size());
+	      // buckets were written unbalanced; even them out once here
+	      // (the run merge range partitions its output itself)
 
-		  fflush(NULL);
+	      if(!binRebalance_ && !finalMerge_)
+		par::partitionW<sortRecord>(binnedData,NULL,BIN_COMMS_[sortGroup]);
+
+	      sprintf(tmpFilename,"%s/part_bin%.3i_p%.5i",outputDir_.c_str(),ibin,sortRank_);
+	      grvy_check_file_path(tmpFilename);
 	      
-		  //par::HyperQuickSort_kway(binnedData, out, BIN_COMMS_[sortGroup]);
-		  //par::HyperQuickSort_kway(binnedData, BIN_COMMS_[sortGroup]);  // working for SC13
-		  if(useSkewSort_)
-		    {
-		      //par::sampleSortSkewed(binnedData,BIN_COMMS_[sortGroup]);
-		      par::sampleSort_skewed2(binnedData,BIN_COMMS_[sortGroup]);
-		    }
-		  else
-		    par::sampleSort(binnedData,BIN_COMMS_[sortGroup]);
+	      //par::HyperQuickSort_kway(binnedData, out, BIN_COMMS_[sortGroup]);
+	      //par::HyperQuickSort_kway(binnedData, BIN_COMMS_[sortGroup]);  // working for SC13
+	      if(finalMerge_)
+		{
+		  // runs are already sorted: merge them and write the
+		  // output as it is produced
+
+		  par::mergeRunsAndWrite(binnedData,binRuns,tmpFilename,BIN_COMMS_[sortGroup]);
+		}
+	      else if(useSkewSort_)
+		{
+		  //par::sampleSortSkewed(binnedData,BIN_COMMS_[sortGroup]);
+		  par::sampleSort_skewed2(binnedData,BIN_COMMS_[sortGroup]);
+		}
+	      else
+		{
+		  par::sampleSort(binnedData,BIN_COMMS_[sortGroup],&arena_);
+		  if(!recycle)
+		    std::vector<sortRecord>().swap(arena_.scratch);
+		}
 
-		  gt.EndTimer("Final Sort");
+	      gt.EndTimer("Final Sort");
 
-		  {
-		    scoped_lock<interprocess_mutex> lock(sortSync->mutex);
-		    sortSync->activeSorts--;
-		    sortSync->condSortFinished.notify_all();
-		  }
-	      
-		  if(binRanks_[sortGroup] == 0)
-		    grvy_printf(INFO,"[sortio][FINALSORT] Group %i finished sort\n",sortGroup);
+	      if(binRanks_[sortGroup] == 0)
+		grvy_printf(INFO,"[sortio][FINALSORT] Group %i finished sort\n",sortGroup);
+
+	      if(!finalMerge_)
+		printResults(BIN_COMMS_[sortGroup]);
+
+	      // lend our cores to the other sort tasks on this host until
+	      // the next bin is ready to sort
 
-		  if(isBinTask_[sortGroup])
-		    printResults(BIN_COMMS_[sortGroup]);
+	      omp_par::task_pool().donate(numSortThreads_);
+	      coresDonated = true;
 
-		  // do final write
+	      // (4) hand the sorted bin to the background writer once the
+	      // previous write is done
 
+	      gt.BeginTimer("Final Write");	  
+	      waitFinalStage(writeStage);
+	      gt.EndTimer("Final Write");	  
+
+	      if(finalMerge_)
+		releaseFinalSortMem(sortSync,binReserved);
+	      else
+		{
 		  if(binRanks_[sortGroup] == 0)
 		    grvy_printf(INFO,"[sortio][FINALSORT] Group %i starting final write\n",sortGroup);
 
-		  fflush(NULL);
-	      
-		  gt.BeginTimer("Final Write");	  
-		  sprintf(tmpFilename,"%s/part_bin%.3i_p%.5i",outputDir_.c_str(),ibin,sortRank_);
-		  grvy_check_file_path(tmpFilename);
-		  
-		  FILE *fp = fopen(tmpFilename,"wb");
-		  assert(fp != NULL);
-		  
-		  fwrite(&binnedData[0],sizeof(sortRecord),binnedData.size(),fp);
-		  fclose(fp);
-		  gt.EndTimer("Final Write");	  
-		  
-		  fflush(NULL);
-
+		  writeStage.ibin     = ibin;
+		  writeStage.outFile  = tmpFilename;
+		  writeStage.reserved = binReserved;
+		  writeStage.data.swap(binnedData);
+		  startFinalStage(writeStage);
 		}
 
 	      if(binRanks_[sortGroup] == 0)
@@ -910,6 +1025,16 @@ void sortio_Class::manageSortProcess()
 
 	    } // end loop over numSortBins_
 
+	  gt.BeginTimer("Final Write");	  
+	  waitFinalStage(writeStage);
+	  gt.EndTimer("Final Write");	  
+
+	  // donated cores stay with the host ledger; the others may still
+	  // be sorting
+
+	  omp_par::task_pool().stop();
+	  arena_.release();
+
 	  // verify we re-read in all the data
 
 	  long int globalRead = 0;
@@ -984,7 +1109,15 @@ void sortio_Class::cycleBinGroup(int numFilesTotal,int currentGroup)
   grvy_printf(DEBUG,"[sortio][Bin/Cycle] Rank %i (group %i) is activating rank %i (%i)\n",
 	      sortRank_,binNum_,destRank,localIter );
 
-  assert (MPI_Send(&numFilesTotal,1,MPI_INT,destRank,tag+activeBin_,SORT_COMM) == MPI_SUCCESS);
+  // non-blocking handoff so that local bucketing/writes proceed while
+  // the next group goes active; only one activation is pending at a time
+
+  if(binCycleReq_ != MPI_REQUEST_NULL)
+    assert (MPI_Wait(&binCycleReq_,MPI_STATUS_IGNORE) == MPI_SUCCESS);
+
+  binCycleMsg_ = numFilesTotal;
+
+  assert (MPI_Isend(&binCycleMsg_,1,MPI_INT,destRank,tag+activeBin_,SORT_COMM,&binCycleReq_) == MPI_SUCCESS);
 
   localIter++;
 		   
@@ -1020,3 +1153,515 @@ int sortio_Class::waitForActivation()
 
   return(numFilesTotal);
 }
+
+// --------------------------------------------------------------------
+// waitForIpcData(): sleep on the IPC condition variable until the
+// local XFER task flags a full buffer or timeoutMs expires. Returns
+// true (with payload size) if data is available.
+// --------------------------------------------------------------------
+
+bool sortio_Class::waitForIpcData(shmem_xfer_sync *sync, int &bufSize, int timeoutMs)
+{
+  using namespace boost::interprocess;
+
+  boost::posix_time::ptime timeout = boost::posix_time::microsec_clock::universal_time() + 
+    boost::posix_time::milliseconds(timeoutMs);
+
+  scoped_lock<interprocess_mutex> lock(sync->mutex);
+
+  while(sync->isReadyForNewData)
+    if(!sync->condFull.timed_wait(lock,timeout))
+      break;
+
+  if(sync->isReadyForNewData)
+    return(false);
+
+  bufSize = sync->bufSizeAvail;
+  return(true);
+}
+
+// --------------------------------------------------------------------
+// waitForRequest(): complete a non-blocking collective without
+// spinning at full speed inside MPI_Wait. Requests which complete
+// promptly are caught by a short burst of tests; after that, the
+// task sleeps between tests while waiting on its peers.
+// --------------------------------------------------------------------
+
+void sortio_Class::waitForRequest(MPI_Request *request)
+{
+  const int NUM_SPIN_TESTS  = 1000;
+  const int USLEEP_INTERVAL = 100;
+  int flag = 0;
+
+  for(int i=0;;i++)
+    {
+      assert (MPI_Test(request,&flag,MPI_STATUS_IGNORE) == MPI_SUCCESS);
+      if(flag)
+	break;
+      if(i >= NUM_SPIN_TESTS)
+	usleep(USLEEP_INTERVAL);
+    }
+
+  return;
+}
+
+// --------------------------------------------------------------------
+// Summarize per BIN group active/idle times (max across hosts) to aid
+// in selecting num_sort_groups; collective across SORT_COMM
+// --------------------------------------------------------------------
+
+void sortio_Class::summarizeBinGroups()
+{
+  const int numFields = 3;
+
+  std::vector<double> local (numFields*numSortGroups_,0.0);
+  std::vector<double> global(numFields*numSortGroups_,0.0);
+
+  if(binNum_ >= 0)
+    {
+      local[numFields*binNum_ + 0] = binActiveTime_;
+      local[numFields*binNum_ + 1] = binIdleTime_;
+      local[numFields*binNum_ + 2] = binActivations_;
+    }
+
+  assert (MPI_Reduce(local.data(),global.data(),local.size(),MPI_DOUBLE,MPI_MAX,0,SORT_COMM) == MPI_SUCCESS);
+
+  if(isMasterSort_)
+    {
+      grvy_printf(INFO,"[sortio][SORT/BIN]\n");
+      grvy_printf(INFO,"[sortio][SORT/BIN] BIN group utilization (max across hosts):\n");
+      grvy_printf(INFO,"[sortio][SORT/BIN]  Group  Activations   Active (secs)   Idle (secs)   Idle %%\n");
+
+      for(int i=0;i<numSortGroups_;i++)
+	{
+	  double active = global[numFields*i + 0];
+	  double idle   = global[numFields*i + 1];
+	  double total  = active + idle;
+
+	  grvy_printf(INFO,"[sortio][SORT/BIN]  %5i  %11i  %14.3f  %12.3f  %6.2f\n",i,
+		      (int)global[numFields*i + 2],active,idle,total > 0 ? 100.0*idle/total : 0.0);
+	}
+    }
+
+  return;
+}
+
+// --------------------------------------------------------------------
+// Report load imbalance (max/mean records across BIN_COMM) of the
+// buckets written in one binning pass when per-pass rebalancing is
+// disabled; collective across comm
+// --------------------------------------------------------------------
+
+void sortio_Class::reportBucketImbalance(std::vector<int> &writeCounts, MPI_Comm comm, int outputCount)
+{
+  int numBuckets = writeCounts.size();
+  int binRank, binSize;
+
+  std::vector<int> maxCounts(numBuckets,0);
+  std::vector<int> sumCounts(numBuckets,0);
+
+  MPI_Comm_rank(comm,&binRank);
+  MPI_Comm_size(comm,&binSize);
+
+  assert (MPI_Reduce(writeCounts.data(),maxCounts.data(),numBuckets,MPI_INT,MPI_MAX,0,comm) == MPI_SUCCESS);
+  assert (MPI_Reduce(writeCounts.data(),sumCounts.data(),numBuckets,MPI_INT,MPI_SUM,0,comm) == MPI_SUCCESS);
+
+  if(binRank == 0)
+    {
+      int    worstBucket    = 0;
+      double worstImbalance = 1.0;
+
+      for(int i=0;i<numBuckets;i++)
+	{
+	  double mean = (double)sumCounts[i]/binSize;
+	  double imbalance = (mean > 0) ? maxCounts[i]/mean : 1.0;
+
+	  grvy_printf(DEBUG,"[sortio][SORT/BIN] bucket %3i: max = %i, mean = %.1f (count=%i)\n",
+		      i,maxCounts[i],mean,outputCount);
+
+	  if(imbalance > worstImbalance)
+	    {
+	      worstImbalance = imbalance;
+	      worstBucket    = i;
+	    }
+	}
+
+      grvy_printf(INFO,"[sortio][SORT/BIN][%.4i] Max bucket imbalance = %.3f (bucket %i, count=%i)\n",
+		  sortRank_,worstImbalance,worstBucket,outputCount);
+    }
+
+  return;
+}
+
+// --------------------------------------------------------------------
+// readTmpFiles(): bulk re-read of temporary bucket files. The output
+// buffer is sized exactly from the file sizes and each file is read
+// concurrently with large pread() calls directly into its slot
+// (optionally with O_DIRECT through an aligned bounce buffer).
+// Returns the total # of records read.
+// --------------------------------------------------------------------
+
+size_t sortio_Class::readTmpFiles(std::vector<std::string> &files, std::vector<sortRecord> &data)
+{
+  const size_t MAX_READ_SIZE = 64*1024*1024;  // max bytes per pread()
+  const size_t DIRECT_ALIGN  = 4096;
+  const int    numFiles      = files.size();
+
+  std::vector<size_t> offsets(numFiles+1,0);
+
+  for(int i=0;i<numFiles;i++)
+    {
+      struct stat st;
+      int ierr = stat(files[i].c_str(),&st);
+      if(ierr != 0)
+	grvy_printf(ERROR,"[sortio][FINALSORT][%.4i] Unable to access file %s\n",sortRank_,files[i].c_str());
+      assert(ierr == 0);
+      assert(st.st_size % sizeof(sortRecord) == 0);
+
+      offsets[i+1] = offsets[i] + st.st_size/sizeof(sortRecord);
+    }
+
+  data.resize(offsets[numFiles]);
+
+  int numThreads = std::max(1,std::min(numFiles,numSortThreads_));
+
+#pragma omp parallel for schedule(dynamic,1) num_threads(numThreads)
+  for(int i=0;i<numFiles;i++)
+    {
+      size_t remain = (offsets[i+1] - offsets[i])*sizeof(sortRecord);
+      char  *dest   = (char *)(data.data() + offsets[i]);
+      char  *bounce = NULL;
+      off_t  offset = 0;
+      int    fd     = -1;
+
+      if(directTmpRead_)
+	{
+	  fd = open(files[i].c_str(),O_RDONLY | O_DIRECT);
+	  if(fd < 0)
+	    grvy_printf(DEBUG,"[sortio][FINALSORT][%.4i] O_DIRECT unavailable for %s, using buffered read\n",
+			sortRank_,files[i].c_str());
+	  else
+	    {
+	      int ierr = posix_memalign((void **)&bounce,DIRECT_ALIGN,MAX_READ_SIZE);
+	      assert(ierr == 0);
+	    }
+	}
+
+      if(fd < 0)
+	fd = open(files[i].c_str(),O_RDONLY);
+
+      if(fd < 0)
+	grvy_printf(ERROR,"[sortio][FINALSORT][%.4i] Unable to access file %s\n",sortRank_,files[i].c_str());
+      assert(fd >= 0);
+
+      grvy_printf(DEBUG,"[sortio][FINALSORT][%.4i] Read in file %s (%zi bytes)\n",sortRank_,
+		  files[i].c_str(),remain);
+
+      while(remain > 0)
+	{
+	  ssize_t nread;
+
+	  if(bounce != NULL)
+	    {
+	      // full aligned block reads; the last one is short at eof
+	      nread = pread(fd,bounce,MAX_READ_SIZE,offset);
+	      if(nread > (ssize_t)remain)
+		nread = remain;
+	      if(nread > 0)
+		memcpy(dest,bounce,nread);
+	    }
+	  else
+	    nread = pread(fd,dest,std::min(remain,MAX_READ_SIZE),offset);
+
+	  if(nread <= 0)
+	    grvy_printf(ERROR,"[sortio][FINALSORT][%.4i] Short read for %s\n",sortRank_,files[i].c_str());
+	  assert(nread > 0);
+
+	  dest   += nread;
+	  offset += nread;
+	  remain -= nread;
+	}
+
+      close(fd);
+      free(bounce);
+    }
+
+  return(data.size());
+}
+
+// --------------------------------------------------------------------
+// finalBinFiles(): tmp bucket files (one per bin group on this host)
+// holding bin ibin, plus their sorted run lengths when final_merge is
+// enabled
+// --------------------------------------------------------------------
+
+void sortio_Class::finalBinFiles(int ibin, int sortGroup, int numBinGroups, std::vector<std::string> &files,
+				 std::vector<DendroIntL> &runs)
+{
+  char filename[1024];
+
+  files.clear();
+  runs.clear();
+
+  for(int igroup=0;igroup<numBinGroups;igroup++)
+    {
+      sprintf(filename,"%s/bins/proc%.4i_g%.2i",tmpDir_.c_str(),binRanks_[sortGroup],igroup);
+
+      if(finalMerge_)
+	{
+	  std::vector< std::pair<long long,long> > binRuns;
+	  par::BucketWriter::readIndex(filename,ibin,binRuns);
+	  for(size_t i=0;i<binRuns.size();i++)
+	    runs.push_back(binRuns[i].second);
+	}
+
+      sprintf(filename,"%s/bins/proc%.4i_g%.2i_%.3i.dat",tmpDir_.c_str(),binRanks_[sortGroup],igroup,ibin);
+      files.push_back(filename);
+    }
+
+  return;
+}
+
+// --------------------------------------------------------------------
+// tmpFilesBytes(): total size of a set of tmp files
+// --------------------------------------------------------------------
+
+size_t sortio_Class::tmpFilesBytes(std::vector<std::string> &files)
+{
+  size_t bytes = 0;
+
+  for(size_t i=0;i<files.size();i++)
+    {
+      struct stat st;
+      int ierr = stat(files[i].c_str(),&st);
+      if(ierr != 0)
+	grvy_printf(ERROR,"[sortio][FINALSORT][%.4i] Unable to access file %s\n",sortRank_,files[i].c_str());
+      assert(ierr == 0);
+
+      bytes += st.st_size;
+    }
+
+  return(bytes);
+}
+
+// --------------------------------------------------------------------
+// reserveFinalSortMem(): charge a bin against the per-host final sort
+// memory budget. Bins are admitted strictly in order on every host
+// (so that BIN_COMM collectives cannot deadlock on memory held by a
+// later bin) and a bin always fits when nothing else is resident
+// (in-memory runs pinned for later bins do not block admission).
+// With wait=false, returns false instead of blocking.
+// --------------------------------------------------------------------
+
+bool sortio_Class::reserveFinalSortMem(shmem_finalsort_sync *sync, int ibin, size_t bytes, bool wait)
+{
+  using namespace boost::interprocess;
+
+  const size_t budget = (size_t)finalSortMemMBs_*1024*1024;
+  bool stalled = false;
+
+  scoped_lock<interprocess_mutex> lock(sync->mutex);
+
+  while(true)
+    {
+      bool fits = (budget == 0) || (sync->activeBytes == sync->pinnedBytes) ||
+	(sync->activeBytes + bytes <= budget);
+
+      if( (sync->nextBin == ibin) && fits)
+	break;
+
+      if(!wait)
+	return(false);
+
+      if(!stalled)
+	grvy_printf(DEBUG,"[sortio][FINALSORT][%.4i] bin %i stalling (%zi MBs resident)\n",sortRank_,
+		    ibin,sync->activeBytes/(1024*1024));
+      stalled = true;
+
+      sync->condMemReleased.wait(lock);
+    }
+
+  sync->activeBytes += bytes;
+  sync->nextBin++;
+  sync->condMemReleased.notify_all();
+
+  if( (budget > 0) && (bytes > budget) )
+    grvy_printf(ERROR,"[sortio][FINALSORT][%.4i] Warning: bin %i needs %zi MBs, exceeding final sort budget (%i MBs)\n",
+		sortRank_,ibin,bytes/(1024*1024),finalSortMemMBs_);
+
+  return(true);
+}
+
+void sortio_Class::releaseFinalSortMem(shmem_finalsort_sync *sync, size_t bytes)
+{
+  using namespace boost::interprocess;
+
+  scoped_lock<interprocess_mutex> lock(sync->mutex);
+
+  assert(sync->activeBytes >= bytes);
+  sync->activeBytes -= bytes;
+  sync->condMemReleased.notify_all();
+
+  return;
+}
+
+// pinFinalSortMem(): charge (pin=true) or release memory that is
+// already resident outside of any bin reservation (binned runs kept
+// in RAM until their bin is read)
+
+void sortio_Class::pinFinalSortMem(shmem_finalsort_sync *sync, size_t bytes, bool pin)
+{
+  using namespace boost::interprocess;
+
+  if(bytes == 0)
+    return;
+
+  scoped_lock<interprocess_mutex> lock(sync->mutex);
+
+  if(pin)
+    {
+      sync->activeBytes += bytes;
+      sync->pinnedBytes += bytes;
+    }
+  else
+    {
+      assert(sync->pinnedBytes >= bytes);
+      sync->activeBytes -= bytes;
+      sync->pinnedBytes -= bytes;
+      sync->condMemReleased.notify_all();
+    }
+
+  return;
+}
+
+// --------------------------------------------------------------------
+// Background read/write stages of the final sort pipeline; no MPI is
+// used off the main thread
+// --------------------------------------------------------------------
+
+void *sortio_Class::finalStageWork(void *arg)
+{
+  FinalBinStage *stage = (FinalBinStage *)arg;
+
+  if(stage->outFile.empty())
+    {
+      stage->sortio->readTmpFiles(stage->files,stage->data);
+    }
+  else
+    {
+      FILE *fp = fopen(stage->outFile.c_str(),"wb");
+      assert(fp != NULL);
+
+      size_t count = fwrite(stage->data.data(),sizeof(sortRecord),stage->data.size(),fp);
+      assert(count == stage->data.size());
+      fclose(fp);
+
+      if(stage->recycle)
+	stage->data.clear();
+      else
+	std::vector<sortRecord>().swap(stage->data);
+      releaseFinalSortMem(stage->sync,stage->reserved);
+    }
+
+  return(NULL);
+}
+
+void sortio_Class::startFinalStage(FinalBinStage &stage)
+{
+  assert(!stage.active);
+
+  int ierr = pthread_create(&stage.thread,NULL,finalStageWork,&stage);
+  assert(ierr == 0);
+  stage.active = true;
+
+  return;
+}
+
+void sortio_Class::waitFinalStage(FinalBinStage &stage)
+{
+  if(!stage.active)
+    return;
+
+  int ierr = pthread_join(stage.thread,NULL);
+  assert(ierr == 0);
+  stage.active = false;
+
+  return;
+}
+
+// --------------------------------------------------------------------
+// exchangeMemRuns(): gather the binned runs held in memory by each
+// BIN task on this host to the task owning the bin in the final sort
+// (host rank = bin % numFinalSortGroups_). One gather per bin keeps
+// the extra memory to a single bin. Collective across SORT_HOST_COMM.
+// --------------------------------------------------------------------
+
+void sortio_Class::exchangeMemRuns(par::BucketWriter &writer, std::vector< std::vector<sortRecord> > &memBins,
+				   std::vector< std::vector<DendroIntL> > &memRuns)
+{
+  int hostRank, hostSize;
+
+  MPI_Comm_rank(SORT_HOST_COMM,&hostRank);
+  MPI_Comm_size(SORT_HOST_COMM,&hostSize);
+
+  assert( (binNum_ < 0) || (hostRank == binNum_) );
+  assert( numFinalSortGroups_ <= hostSize );
+
+  memBins.assign(numSortBins_,std::vector<sortRecord>());
+  memRuns.assign(numSortBins_,std::vector<DendroIntL>());
+
+  double localBytes[2]  = {(double)writer.memBytes(),(double)writer.spilledBytes()};
+  double globalBytes[2] = {0.0,0.0};
+
+  assert (MPI_Reduce(localBytes,globalBytes,2,MPI_DOUBLE,MPI_SUM,0,SORT_COMM) == MPI_SUCCESS);
+
+  if(isMasterSort_)
+    grvy_printf(INFO,"[sortio][FINALSORT] Binned runs in memory = %.1f MBs, spilled = %.1f MBs\n",
+		globalBytes[0]/(1024*1024),globalBytes[1]/(1024*1024));
+
+  std::vector<int> numRuns(hostSize), runDisp(hostSize);
+  std::vector<int> numRecs(hostSize), recDisp(hostSize);
+
+  for(int ibin=0;ibin<numSortBins_;ibin++)
+    {
+      const int owner = ibin % numFinalSortGroups_;
+
+      std::vector<sortRecord> data;
+      std::vector<long> counts;
+
+      if(binNum_ >= 0)
+	writer.takeMemRuns(ibin,data,counts);
+
+      int localRuns = counts.size();
+      int localRecs = data.size();
+
+      assert (MPI_Gather(&localRuns,1,MPI_INT,numRuns.data(),1,MPI_INT,owner,SORT_HOST_COMM) == MPI_SUCCESS);
+      assert (MPI_Gather(&localRecs,1,MPI_INT,numRecs.data(),1,MPI_INT,owner,SORT_HOST_COMM) == MPI_SUCCESS);
+
+      std::vector<long> allCounts;
+
+      if(hostRank == owner)
+	{
+	  runDisp[0] = recDisp[0] = 0;
+	  for(int i=1;i<hostSize;i++)
+	    {
+	      runDisp[i] = runDisp[i-1] + numRuns[i-1];
+	      recDisp[i] = recDisp[i-1] + numRecs[i-1];
+	    }
+
+	  allCounts.resize(runDisp[hostSize-1] + numRuns[hostSize-1]);
+	  memBins[ibin].resize(recDisp[hostSize-1] + numRecs[hostSize-1]);
+	}
+
+      assert (MPI_Gatherv(counts.data(),localRuns,MPI_LONG,allCounts.data(),numRuns.data(),
+			  runDisp.data(),MPI_LONG,owner,SORT_HOST_COMM) == MPI_SUCCESS);
+      assert (MPI_Gatherv(data.data(),localRecs,par::Mpi_datatype<sortRecord>::value(),
+			  memBins[ibin].data(),numRecs.data(),recDisp.data(),
+			  par::Mpi_datatype<sortRecord>::value(),owner,SORT_HOST_COMM) == MPI_SUCCESS);
+
+      for(size_t i=0;i<allCounts.size();i++)
+	memRuns[ibin].push_back(allCounts[i]);
+    }
+
+  return;
+}
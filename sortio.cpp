@@ -55,6 +55,25 @@ sortio_Class::sortio_Class()
   sortMode_                 = 0;
   activeBin_                = 0;
   useSkewSort_              = 0;
+  useRmaXfer_               = 0;
+  ioHostsSort_              = 0;
+  targetRunSizeMBs_         = 0;
+  asyncWriteMBs_            = 0;
+  binRebalance_             = 1;
+  directTmpRead_            = 0;
+  finalMerge_               = 0;
+  localSortMethod_          = omp_par::MERGE_SORT;
+  simdLevel_                = seq::SIMD_AUTO;
+  numaMerge_                = omp_par::MERGE_FLAT;
+  taskPool_                 = 0;
+  finalSortMemMBs_          = 0;
+  hostMemMBs_               = 0;
+  binMemMBs_                = 0;
+  binCycleReq_              = MPI_REQUEST_NULL;
+  binActivations_           = 0;
+  binIdleTime_              = 0.0;
+  binActiveTime_            = 0.0;
+  xferFlags_                = NULL;
   binNum_                   = -1;
   localSortRank_            = -1;
   localXferRank_            = -1;
@@ -299,8 +318,22 @@ void sortio_Class::Initialize(std::string ifile, MPI_Comm COMM)
       iparse.Register_Var("sortio/verify_mode",             0);
       iparse.Register_Var("sortio/sort_mode",               1);
       iparse.Register_Var("sortio/num_sort_bins",          10);
+      iparse.Register_Var("sortio/target_run_size_mbs",     0);
+      iparse.Register_Var("sortio/async_write_mbs",         0);
+      iparse.Register_Var("sortio/bin_rebalance",           1);
+      iparse.Register_Var("sortio/tmp_read_direct",         0);
+      iparse.Register_Var("sortio/final_merge",             0);
+      iparse.Register_Var("sortio/local_sort",              0);
+      iparse.Register_Var("sortio/simd_level",             -1);
+      iparse.Register_Var("sortio/numa_merge",              0);
+      iparse.Register_Var("sortio/task_pool",               0);
       iparse.Register_Var("sortio/enable_skew_kernel",      0);
-      iparse.Register_Var("sortio/max_final_sorters",       1);
+      iparse.Register_Var("sortio/enable_rma_xfer",         0);
+      iparse.Register_Var("sortio/io_hosts_sort",           0);
+      iparse.Register_Var("sortio/topology_file",          "");
+      iparse.Register_Var("sortio/final_sort_mem_mbs",      0);
+      iparse.Register_Var("sortio/host_mem_mbs",            0);
+      iparse.Register_Var("sortio/bin_mem_mbs",             0);
       iparse.Register_Var("sortio/num_final_sorters",       1);
 
       if(!overrideNumSortGroups_)
@@ -317,7 +350,12 @@ void sortio_Class::Initialize(std::string ifile, MPI_Comm COMM)
       assert( iparse.Read_Var("sortio/verify_mode",           &verifyMode_)            != 0 );
       assert( iparse.Read_Var("sortio/sort_mode",             &sortMode_)              != 0 );
       assert( iparse.Read_Var("sortio/enable_skew_kernel",    &useSkewSort_)           != 0 );
-      assert( iparse.Read_Var("sortio/max_final_sorters",     &numMaxFinalSorters_)    != 0 );
+      assert( iparse.Read_Var("sortio/enable_rma_xfer",       &useRmaXfer_)            != 0 );
+      assert( iparse.Read_Var("sortio/io_hosts_sort",         &ioHostsSort_)           != 0 );
+      assert( iparse.Read_Var("sortio/topology_file",         &topologyFile_)          != 0 );
+      assert( iparse.Read_Var("sortio/final_sort_mem_mbs",    &finalSortMemMBs_)       != 0 );
+      assert( iparse.Read_Var("sortio/host_mem_mbs",          &hostMemMBs_)            != 0 );
+      assert( iparse.Read_Var("sortio/bin_mem_mbs",           &binMemMBs_)             != 0 );
       assert( iparse.Read_Var("sortio/num_final_sorters",     &numFinalSortGroups_)    != 0 );
 
       if(!overrideNumSortGroups_)
@@ -326,6 +364,15 @@ void sortio_Class::Initialize(std::string ifile, MPI_Comm COMM)
 	assert( iparse.Read_Var("sortio/num_sort_threads",      &numSortThreads_       ) != 0 );
 
       assert( iparse.Read_Var("sortio/num_sort_bins",         &numSortBins_          ) != 0 );
+      assert( iparse.Read_Var("sortio/target_run_size_mbs",   &targetRunSizeMBs_     ) != 0 );
+      assert( iparse.Read_Var("sortio/async_write_mbs",       &asyncWriteMBs_        ) != 0 );
+      assert( iparse.Read_Var("sortio/bin_rebalance",         &binRebalance_         ) != 0 );
+      assert( iparse.Read_Var("sortio/tmp_read_direct",       &directTmpRead_        ) != 0 );
+      assert( iparse.Read_Var("sortio/final_merge",           &finalMerge_           ) != 0 );
+      assert( iparse.Read_Var("sortio/local_sort",            &localSortMethod_      ) != 0 );
+      assert( iparse.Read_Var("sortio/simd_level",            &simdLevel_            ) != 0 );
+      assert( iparse.Read_Var("sortio/numa_merge",            &numaMerge_            ) != 0 );
+      assert( iparse.Read_Var("sortio/task_pool",             &taskPool_             ) != 0 );
       assert( iparse.Read_Var("sortio/max_read_buffers",      &MAX_READ_BUFFERS)       != 0 );
       assert( iparse.Read_Var("sortio/max_file_size_in_mbs"  ,&MAX_FILE_SIZE_IN_MBS)   != 0 );
       assert( iparse.Read_Var("sortio/max_messages_watermark",&MAX_MESSAGES_WATERMARK) != 0 );
@@ -334,6 +381,15 @@ void sortio_Class::Initialize(std::string ifile, MPI_Comm COMM)
 
       assert( numIoHosts_          > 0);
       assert( numSortBins_         > 0);
+      assert( targetRunSizeMBs_   >= 0);
+      assert( asyncWriteMBs_      >= 0);
+      assert( finalSortMemMBs_    >= 0);
+      assert( hostMemMBs_         >= 0);
+      assert( binMemMBs_          >= 0);
+      assert( (localSortMethod_ >= omp_par::MERGE_SORT) && (localSortMethod_ <= omp_par::INPLACE_SAMPLE_SORT) );
+      assert( (simdLevel_ >= seq::SIMD_AUTO) && (simdLevel_ <= seq::SIMD_AVX512) );
+      assert( (numaMerge_ == omp_par::MERGE_FLAT) || (numaMerge_ == omp_par::MERGE_NUMA) );
+      assert( (taskPool_ >= 0) && (taskPool_ <= 2) );
       assert( MAX_READ_BUFFERS     > 0);
       assert( MAX_FILE_SIZE_IN_MBS > 0);
       assert( (numSortGroups_  >= 1) && (numSortGroups_  < 16) );   // Assume 16-way hosts or less (need 2 minimum)
@@ -350,10 +406,25 @@ void sortio_Class::Initialize(std::string ifile, MPI_Comm COMM)
       grvy_printf(INFO,"[sortio] --> Number of read buffers          = %i\n",MAX_READ_BUFFERS);
       grvy_printf(INFO,"[sortio] --> Size of each read buffer        = %i MBs\n",MAX_FILE_SIZE_IN_MBS);
       grvy_printf(INFO,"[sortio] --> Enable skewed sort kernel?      = %i\n",useSkewSort_);
+      grvy_printf(INFO,"[sortio] --> Enable one-sided RMA transfers? = %i\n",useRmaXfer_);
+      grvy_printf(INFO,"[sortio] --> Sort on IO hosts (hybrid)?      = %i\n",ioHostsSort_);
+      if(topologyFile_.size() > 0)
+	grvy_printf(INFO,"[sortio] --> Network topology file           = %s\n",topologyFile_.c_str());
       grvy_printf(INFO,"[sortio] --> Number of sort bins             = %i\n",numSortBins_);
       grvy_printf(INFO,"[sortio] --> Number of sort groups (binning) = %i\n",numSortGroups_);
+      grvy_printf(INFO,"[sortio] --> Target binning run size         = %i MBs (0=auto)\n",targetRunSizeMBs_);
+      grvy_printf(INFO,"[sortio] --> Async bucket write queue        = %i MBs (0=sync)\n",asyncWriteMBs_);
+      grvy_printf(INFO,"[sortio] --> Rebalance buckets every pass?   = %i\n",binRebalance_);
+      grvy_printf(INFO,"[sortio] --> Direct IO for temp file reads?  = %i\n",directTmpRead_);
+      grvy_printf(INFO,"[sortio] --> Merge sorted runs in final sort? = %i\n",finalMerge_);
+      grvy_printf(INFO,"[sortio] --> Local sort (0=merge,1=radix,2=ips)= %i\n",localSortMethod_);
+      grvy_printf(INFO,"[sortio] --> Max SIMD level (-1=auto)        = %i\n",simdLevel_);
+      grvy_printf(INFO,"[sortio] --> NUMA-local merge sort?          = %i\n",numaMerge_);
+      grvy_printf(INFO,"[sortio] --> Task pool (0=omp,1=pool,2=shared)= %i\n",taskPool_);
       grvy_printf(INFO,"[sortio] --> Number of sort groups ( final ) = %i\n",numFinalSortGroups_);
-      grvy_printf(INFO,"[sortio] --> Number of sync sorts  ( final ) = %i\n",numMaxFinalSorters_);
+      grvy_printf(INFO,"[sortio] --> Final sort memory/host          = %i MBs (0=unlimited)\n",finalSortMemMBs_);
+      grvy_printf(INFO,"[sortio] --> Memory budget/host (planner)    = %i MBs (0=manual)\n",hostMemMBs_);
+      grvy_printf(INFO,"[sortio] --> In-memory binned runs/host      = %i MBs (0=always spill)\n",binMemMBs_);
       grvy_printf(INFO,"[sortio] --> Number of sort threads          = %i\n",numSortThreads_);
 
     }
@@ -363,10 +434,12 @@ void sortio_Class::Initialize(std::string ifile, MPI_Comm COMM)
   int tmp_string_size  = inputDir_.size()  + 1;
   int tmp_string_size2 = outputDir_.size() + 1;
   int tmp_string_size3 = tmpDir_.size()    + 1;      
+  int tmp_string_size4 = topologyFile_.size() + 1;
 
   char *tmp_string     = NULL;
   char *tmp_string2    = NULL;
   char *tmp_string3    = NULL;
+  char *tmp_string4    = NULL;
 
   //  random_read_offset_  = true;
 
@@ -375,16 +448,30 @@ void sortio_Class::Initialize(std::string ifile, MPI_Comm COMM)
   assert( MPI_Bcast(&numSortGroups_,        1,MPI_INT,0,COMM) == MPI_SUCCESS );
   assert( MPI_Bcast(&numSortThreads_,       1,MPI_INT,0,COMM) == MPI_SUCCESS );
   assert( MPI_Bcast(&numSortBins_,          1,MPI_INT,0,COMM) == MPI_SUCCESS );
+  assert( MPI_Bcast(&targetRunSizeMBs_,     1,MPI_INT,0,COMM) == MPI_SUCCESS );
+  assert( MPI_Bcast(&asyncWriteMBs_,        1,MPI_INT,0,COMM) == MPI_SUCCESS );
+  assert( MPI_Bcast(&binRebalance_,         1,MPI_INT,0,COMM) == MPI_SUCCESS );
+  assert( MPI_Bcast(&directTmpRead_,        1,MPI_INT,0,COMM) == MPI_SUCCESS );
+  assert( MPI_Bcast(&finalMerge_,           1,MPI_INT,0,COMM) == MPI_SUCCESS );
+  assert( MPI_Bcast(&localSortMethod_,      1,MPI_INT,0,COMM) == MPI_SUCCESS );
+  assert( MPI_Bcast(&simdLevel_,            1,MPI_INT,0,COMM) == MPI_SUCCESS );
+  assert( MPI_Bcast(&numaMerge_,            1,MPI_INT,0,COMM) == MPI_SUCCESS );
+  assert( MPI_Bcast(&taskPool_,             1,MPI_INT,0,COMM) == MPI_SUCCESS );
   assert( MPI_Bcast(&verifyMode_,           1,MPI_INT,0,COMM) == MPI_SUCCESS );
   assert( MPI_Bcast(&sortMode_,             1,MPI_INT,0,COMM) == MPI_SUCCESS );
   assert( MPI_Bcast(&useSkewSort_,          1,MPI_INT,0,COMM) == MPI_SUCCESS );
+  assert( MPI_Bcast(&useRmaXfer_,           1,MPI_INT,0,COMM) == MPI_SUCCESS );
+  assert( MPI_Bcast(&ioHostsSort_,          1,MPI_INT,0,COMM) == MPI_SUCCESS );
   assert( MPI_Bcast(&MAX_READ_BUFFERS,      1,MPI_INT,0,COMM) == MPI_SUCCESS );
   assert( MPI_Bcast(&MAX_FILE_SIZE_IN_MBS,  1,MPI_INT,0,COMM) == MPI_SUCCESS );
   assert( MPI_Bcast(&MAX_MESSAGES_WATERMARK,1,MPI_INT,0,COMM) == MPI_SUCCESS );
   assert( MPI_Bcast(&tmp_string_size,       1,MPI_INT,0,COMM) == MPI_SUCCESS );
   assert( MPI_Bcast(&tmp_string_size2,      1,MPI_INT,0,COMM) == MPI_SUCCESS );
   assert( MPI_Bcast(&tmp_string_size3,      1,MPI_INT,0,COMM) == MPI_SUCCESS );
-  assert( MPI_Bcast(&numMaxFinalSorters_,   1,MPI_INT,0,COMM) == MPI_SUCCESS );
+  assert( MPI_Bcast(&tmp_string_size4,      1,MPI_INT,0,COMM) == MPI_SUCCESS );
+  assert( MPI_Bcast(&finalSortMemMBs_,      1,MPI_INT,0,COMM) == MPI_SUCCESS );
+  assert( MPI_Bcast(&hostMemMBs_,           1,MPI_INT,0,COMM) == MPI_SUCCESS );
+  assert( MPI_Bcast(&binMemMBs_,            1,MPI_INT,0,COMM) == MPI_SUCCESS );
   assert( MPI_Bcast(&numFinalSortGroups_,   1,MPI_INT,0,COMM) == MPI_SUCCESS );
   
   tmp_string = (char *)calloc(tmp_string_size,sizeof(char));
@@ -396,20 +483,38 @@ void sortio_Class::Initialize(std::string ifile, MPI_Comm COMM)
   tmp_string3 = (char *)calloc(tmp_string_size3,sizeof(char));
   strcpy(tmp_string3,tmpDir_.c_str());
 
+  tmp_string4 = (char *)calloc(tmp_string_size4,sizeof(char));
+  strcpy(tmp_string4,topologyFile_.c_str());
+
   assert (MPI_Bcast(tmp_string, tmp_string_size, MPI_CHAR,0,COMM) == MPI_SUCCESS);
   assert (MPI_Bcast(tmp_string2,tmp_string_size2,MPI_CHAR,0,COMM) == MPI_SUCCESS);
   assert (MPI_Bcast(tmp_string3,tmp_string_size3,MPI_CHAR,0,COMM) == MPI_SUCCESS);
+  assert (MPI_Bcast(tmp_string4,tmp_string_size4,MPI_CHAR,0,COMM) == MPI_SUCCESS);
 
   if(!master)
     {
       inputDir_  = tmp_string;
       outputDir_ = tmp_string2;
       tmpDir_    = tmp_string3;
+      topologyFile_ = tmp_string4;
     }
 
   free(tmp_string);
   free(tmp_string2);
   free(tmp_string3);
+  free(tmp_string4);
+
+  // select the node-local sort (omp_par::local_sort) and its thread placement
+
+  omp_par::local_sort_method() = localSortMethod_;
+  omp_par::merge_policy()      = numaMerge_;
+
+  // bind the SIMD kernels for this CPU (nodes may differ)
+
+  seq::simd_select(simdLevel_);
+
+  if(master)
+    grvy_printf(INFO,"[sortio] SIMD kernels selected on master       = %s\n",seq::simd_kernels().name);
 
   // initialize RNG
 
@@ -450,246 +555,239 @@ void sortio_Class::SplitComm()
   char hostname[MPI_MAX_PROCESSOR_NAME];
   int len;
 
+  memset(hostname,0,MPI_MAX_PROCESSOR_NAME);
   MPI_Get_processor_name(hostname, &len);
 
   grvy_printf(DEBUG,"[sortio] Detected global Rank %i -> %s\n",numLocal_,hostname);
 
-  char *hostnames_ALL;
-
-  if(master)
-    {
-      hostnames_ALL = (char *)malloc(numTasks_*MPI_MAX_PROCESSOR_NAME*sizeof(char));
-      assert(hostnames_ALL != NULL);
-    }
+  // Determine host-local ranks via shared-memory split; one leader
+  // per host (lowest global rank) participates in role assignment so
+  // that only per-host (not per-rank) data is ever gathered.
 
-  assert (MPI_Gather(&hostname[0],     MPI_MAX_PROCESSOR_NAME,MPI_CHAR,
-		     &hostnames_ALL[0],MPI_MAX_PROCESSOR_NAME,MPI_CHAR,0,GLOB_COMM) == MPI_SUCCESS);
+  MPI_Comm NODE_COMM;
+  MPI_Comm LEADER_COMM;
+  int nodeRank, nodeSize;
 
-  std::vector<int>      io_comm_ranks; 
-  std::vector<int>    xfer_comm_ranks;
+  assert( MPI_Comm_split_type(GLOB_COMM,MPI_COMM_TYPE_SHARED,numLocal_,MPI_INFO_NULL,&NODE_COMM) == MPI_SUCCESS);
+  assert( MPI_Comm_rank(NODE_COMM,&nodeRank) == MPI_SUCCESS);
+  assert( MPI_Comm_size(NODE_COMM,&nodeSize) == MPI_SUCCESS);
 
-  std::vector<int>    sort_comm_ranks;
-  std::vector<int>    first_sort_rank;
+  assert( MPI_Comm_split(GLOB_COMM,(nodeRank == 0) ? 0 : MPI_UNDEFINED,numLocal_,&LEADER_COMM) == MPI_SUCCESS);
 
-  std::vector< std::vector<int> > binCommRanks;
+  // global rank 0 is always the leader of its host and rank 0 in LEADER_COMM
 
-  std::map<std::string,std::vector<int> > uniq_hosts; // hostname -> global MPI rank mapping
+  if(master)
+    assert(nodeRank == 0);
 
+  // per-host role: {isIO, ioIndex, isSort, sortIndex, xferOffset}
 
+  const int numRoleFields = 5;
+  int hostRole[numRoleFields];
+  int numHosts = 0;
 
-  if(master)
+  if(nodeRank == 0)
     {
-      // Determine unique hostnames -> rank mapping
+      int leaderRank;
+
+      assert( MPI_Comm_size(LEADER_COMM,&numHosts)   == MPI_SUCCESS);
+      assert( MPI_Comm_rank(LEADER_COMM,&leaderRank) == MPI_SUCCESS);
+
+      char *hostnames = NULL;
+      int  *hostTasks = NULL;
+      int  *roles     = NULL;
 
-      for(int i=0;i<numTasks_;i++)
+      if(master)
 	{
-	  std::string host = &hostnames_ALL[i*MPI_MAX_PROCESSOR_NAME];
- 	  grvy_printf(DEBUG,"[sortio] parsed host = %s\n",host.c_str());
-	  uniq_hosts[host].push_back(i);
+	  hostnames = (char *)malloc(numHosts*MPI_MAX_PROCESSOR_NAME*sizeof(char));
+	  hostTasks = (int  *)malloc(numHosts*sizeof(int));
+	  roles     = (int  *)malloc(numHosts*numRoleFields*sizeof(int));
+	  assert(hostnames != NULL);
+	  assert(hostTasks != NULL);
+	  assert(roles     != NULL);
 	}
 
-      std::map<std::string,std::vector<int> >::iterator it;
-
-      int count = 0;
+      assert (MPI_Gather(hostname,MPI_MAX_PROCESSOR_NAME,MPI_CHAR,
+			 hostnames,MPI_MAX_PROCESSOR_NAME,MPI_CHAR,0,LEADER_COMM) == MPI_SUCCESS);
+      assert (MPI_Gather(&nodeSize,1,MPI_INT,hostTasks,1,MPI_INT,0,LEADER_COMM) == MPI_SUCCESS);
 
-      // Flag tasks for different work groups
+      if(master)
+	{
+	  // hosts are processed in hostname order (leader index stored per name)
 
-      assert (numIoHosts_ > 0);
-      assert (numIoHosts_ < numTasks_);
+	  std::map<std::string,int> uniq_hosts;
+	  std::map<std::string,int>::iterator it;
 
-      grvy_printf(INFO,"[sortio]\n");
-      grvy_printf(INFO,"[sortio] Rank per host detection:\n");
+	  for(int i=0;i<numHosts;i++)
+	    uniq_hosts[&hostnames[i*MPI_MAX_PROCESSOR_NAME]] = i;
 
-      for(int i=0;i<numSortGroups_;i++)
-	{
-	  std::vector <int> iVec;
-	  binCommRanks.push_back(iVec);
-	}
+	  assert( (int)uniq_hosts.size() == numHosts );
 
+	  // Flag tasks for different work groups
 
-      for(it = uniq_hosts.begin(); it != uniq_hosts.end(); it++ ) 
-	{
-	  // Logic: we use the first num_io_hosts for IO (and we
-	  // currently assume 1 MPI task per IO host). We use all
-	  // remaining hosts for SORT with 1 MPI task per sort host
-	  // dedicated for data XFER and all remaining tasks used for
-	  // sorting.
+	  assert (numIoHosts_ > 0);
+	  assert (numIoHosts_ < numTasks_);
 
-	  if(count < numIoHosts_)
-	    {
-	      io_comm_ranks.push_back  ((*it).second[0]);
-	      xfer_comm_ranks.push_back((*it).second[0]);
-	    }
-	  else
-	    {
-	      xfer_comm_ranks.push_back((*it).second[0]);
+	  // assign per-host roles (optionally using network topology)
 
-	      for(size_t proc=1;proc<(*it).second.size();proc++)
-		{
-		  if(proc == 1)
-		    first_sort_rank.push_back((*it).second[proc]);
-		  sort_comm_ranks.push_back((*it).second[proc]);
-		}
+	  std::map<std::string,int> switches = readTopologyFile();
+	  std::vector<HostLayout> layout;
 
-	      // Also build up multiple binning communicators
+	  for(it = uniq_hosts.begin(); it != uniq_hosts.end(); it++ ) 
+	    {
+	      HostLayout host;
+	      host.numTasks = hostTasks[(*it).second];
+	      host.switchId = -1;
 
-	      //binCommRanks.push_back(std::vector<int> iVec);
+	      if(switches.find((*it).first) != switches.end())
+		host.switchId = switches[(*it).first];
 
-	      assert( (*it).second.size() >= (numSortGroups_ + 1) );
+	      layout.push_back(host);
+	    }
 
-	      for(int i=0;i<numSortGroups_;i++)
-		binCommRanks[i].push_back( (*it).second[i+1] );
+	  planHostLayout(layout);
 
-	    }
-	    
-	  grvy_printf(INFO,"[sortio]    %s -> %3i MPI task(s)/host\n",(*it).first.c_str(),(*it).second.size());
-	  count++;
-	}
+	  // Logic: we use 1 MPI task per IO host for IO. On each SORT
+	  // host (which may also be an IO host in hybrid mode) we use 1
+	  // MPI task for receiving data XFER and all remaining tasks for
+	  // sorting.
 
+	  grvy_printf(INFO,"[sortio]\n");
+	  grvy_printf(INFO,"[sortio] Rank per host detection:\n");
 
-      numIoTasks_     = io_comm_ranks.size();
-      numXferTasks_   = xfer_comm_ranks.size();
-      numSortTasks_   = sort_comm_ranks.size();
-      numSortHosts_   = first_sort_rank.size();
+	  int count = 0;
 
-      // Final sort does stalls with non-powers of 2, verify now.
+	  numSortHosts_ = 0;
+	  numSortTasks_ = 0;
 
-#if 0
-      if(sortMode_ > 1)
-	assert(isPowerOfTwo(numSortHosts_));
-#endif
+	  for(it = uniq_hosts.begin(); it != uniq_hosts.end(); it++ ) 
+	    {
+	      const HostLayout &host = layout[count];
+	      int *role = &roles[(*it).second*numRoleFields];
 
-      // quick sanity checks and assumptions
+	      role[0] = host.isIO;
+	      role[1] = host.ioIndex;
+	      role[2] = host.isSort;
+	      role[3] = host.sortIndex;
+	      role[4] = host.xferOffset;
 
-      assert(numIoTasks_   > 0);
-      assert(numXferTasks_ > 0);
-      assert(numXferTasks_ > numIoTasks_);
-      assert(numSortTasks_ > 0);
+	      if(host.isSort)
+		{
+		  numSortHosts_++;
+		  numSortTasks_ += host.numTasks - host.xferOffset - 1;
+		}
 
-      assert(numIoTasks_   == numIoHosts_);
-      assert(numSortHosts_ == ( (int)uniq_hosts.size() - numIoHosts_));
+	      grvy_printf(INFO,"[sortio]    %s -> %3i MPI task(s)/host (switch = %3i) %s%s\n",
+			  (*it).first.c_str(),host.numTasks,host.switchId,
+			  host.isIO ? "[IO]" : "",host.isSort ? "[SORT]" : "");
+	      count++;
+	    }
 
-      assert(numXferTasks_ + numSortTasks_ <= numTasks_);
+	  numIoTasks_     = numIoHosts_;
+	  numXferTasks_   = numIoHosts_ + numSortHosts_;
 
-      // we assume all hosts have the same number of MPI tasks specified
+	  // quick sanity checks and assumptions
 
-      int numTasksPerHost = (*uniq_hosts.begin()).second.size();
-      for(it = uniq_hosts.begin(); it != uniq_hosts.end(); it++ ) 
-	assert( (int)(*it).second.size() == numTasksPerHost);
+	  assert(numIoTasks_   > 0);
+	  assert(numXferTasks_ > numIoTasks_);
+	  assert(numSortTasks_ > 0);
 
-      //      numSortTasksPerHost_ = numTasksPerHost - 1; // 1 task belongs to XFER_COMM
+	  assert(numXferTasks_ + numSortTasks_ <= numTasks_);
 
-      // Create desired MPI sub communicators based on runtime settings
+	  grvy_printf(INFO,"[sortio]\n");
+	  grvy_printf(INFO,"[sortio] Total number of hosts available    = %4i\n",numHosts);
+	  grvy_printf(INFO,"[sortio] --> Number of   IO hosts           = %4i\n",numIoHosts_);
+	  grvy_printf(INFO,"[sortio] --> Number of SORT hosts           = %4i\n",numSortHosts_);
+	  grvy_printf(INFO,"[sortio]\n");
+	  grvy_printf(INFO,"[sortio] Work Task Division:\n");
+	  grvy_printf(INFO,"[sortio] --> Number of IO   MPI tasks       = %4i\n",numIoTasks_);
+	  grvy_printf(INFO,"[sortio] --> Number of XFER MPI tasks       = %4i\n",numXferTasks_);
+	  grvy_printf(INFO,"[sortio] --> Number of SORT MPI tasks       = %4i\n",numSortTasks_);
+	  grvy_printf(INFO,"[sortio] --> Number of BIN  groups          = %4i\n",numSortGroups_);
+	}
 
-      grvy_printf(INFO,"[sortio]\n");
-      grvy_printf(INFO,"[sortio] Total number of hosts available    = %4i\n",uniq_hosts.size());
-      grvy_printf(INFO,"[sortio] --> Number of   IO hosts           = %4i\n",numIoHosts_);
-      grvy_printf(INFO,"[sortio] --> Number of SORT hosts           = %4i\n",numSortHosts_);
-      grvy_printf(INFO,"[sortio]\n");
-      grvy_printf(INFO,"[sortio] Work Task Division:\n");
-      grvy_printf(INFO,"[sortio] --> Number of IO   MPI tasks       = %4i\n",numIoTasks_);
-      grvy_printf(INFO,"[sortio] --> Number of XFER MPI tasks       = %4i\n",numXferTasks_);
-      grvy_printf(INFO,"[sortio] --> Number of SORT MPI tasks       = %4i\n",numSortTasks_);
-      grvy_printf(INFO,"[sortio] --> Number of BIN  groups          = %4i\n",numSortGroups_);
+      assert (MPI_Scatter(roles,numRoleFields,MPI_INT,hostRole,numRoleFields,MPI_INT,0,LEADER_COMM) == MPI_SUCCESS);
 
+      if(master)
+	{
+	  free(hostnames);
+	  free(hostTasks);
+	  free(roles);
+	}
     }
 
-  // Build up new MPI task groups
+  // distribute host roles to all tasks on the host and global counts to everyone
 
-  //gt.BeginTimer("MPI task groups");
+  assert( MPI_Bcast(hostRole,numRoleFields,MPI_INT,0,NODE_COMM) == MPI_SUCCESS );
 
   assert( MPI_Bcast(&numIoTasks_,          1,MPI_INT,0,GLOB_COMM) == MPI_SUCCESS );
   assert( MPI_Bcast(&numXferTasks_,        1,MPI_INT,0,GLOB_COMM) == MPI_SUCCESS );
   assert( MPI_Bcast(&numSortTasks_,        1,MPI_INT,0,GLOB_COMM) == MPI_SUCCESS );
   assert( MPI_Bcast(&numSortHosts_,        1,MPI_INT,0,GLOB_COMM) == MPI_SUCCESS );
+  assert( MPI_Bcast(&numHosts,             1,MPI_INT,0,GLOB_COMM) == MPI_SUCCESS );
 
   assert(numSortHosts_ > 0);
 
-  if(!master)
-    {
-      io_comm_ranks.reserve  (numIoTasks_   );
-      xfer_comm_ranks.reserve(numXferTasks_ );
-      sort_comm_ranks.reserve(numSortTasks_ );
-      first_sort_rank.reserve(numSortHosts_ );
-
-      for(int i=0;i<numSortGroups_;i++)
-	{
-	  std::vector<int> iVec(numSortHosts_);
-	  binCommRanks.push_back(iVec);
-	}
-
-    }
-
-  assert( MPI_Bcast(  io_comm_ranks.data(),numIoTasks_,  MPI_INT,0,GLOB_COMM) == MPI_SUCCESS);
-  assert( MPI_Bcast(xfer_comm_ranks.data(),numXferTasks_,MPI_INT,0,GLOB_COMM) == MPI_SUCCESS);
-  assert( MPI_Bcast(sort_comm_ranks.data(),numSortTasks_,MPI_INT,0,GLOB_COMM) == MPI_SUCCESS);
-  assert( MPI_Bcast(first_sort_rank.data(),numSortHosts_,MPI_INT,0,GLOB_COMM) == MPI_SUCCESS);
-
-  assert(binCommRanks.size() == numSortGroups_);
-
-  for(int i=0;i<numSortGroups_;i++)
-    assert(binCommRanks[i].size() == numSortHosts_);
+  const bool hostIsIO     = (hostRole[0] != 0);
+  const int  hostIoIndex  =  hostRole[1];
+  const bool hostIsSort   = (hostRole[2] != 0);
+  const int  hostSortIdx  =  hostRole[3];
+  const int  xferOffset   =  hostRole[4];
 
-  for(int i=0;i<numSortGroups_;i++)
-    assert( MPI_Bcast(binCommRanks[i].data(),numSortHosts_,MPI_INT,0,GLOB_COMM) == MPI_SUCCESS);
+  // Local role selection based on rank within the host
 
-  MPI_Group group_global;
-  MPI_Group group_io;
-  MPI_Group group_xfer;
-  MPI_Group group_sort;
-  std::vector<MPI_Group> groups_binning(numSortGroups_);
+  isIOTask_   = hostIsIO   && (nodeRank == 0);
+  isXFERTask_ = isIOTask_  || (hostIsSort && (nodeRank == xferOffset));
+  isSortTask_ = hostIsSort && (nodeRank >  xferOffset);
 
-  assert( MPI_Comm_group(GLOB_COMM,&group_global)  == MPI_SUCCESS );
+  isBinTask_.resize(numSortGroups_,false);
 
-  // New groups/communicators for IO, XFER, SORT, and BIN(s)
+  if(isSortTask_ && (nodeRank - xferOffset - 1) < numSortGroups_)
+    {
+      binNum_ = nodeRank - xferOffset - 1;
+      isBinTask_[binNum_] = true;
+    }
 
-  assert( MPI_Group_incl(group_global,   numIoTasks_,   io_comm_ranks.data(),   &group_io) == MPI_SUCCESS);
-  assert( MPI_Group_incl(group_global, numXferTasks_, xfer_comm_ranks.data(), &group_xfer) == MPI_SUCCESS);
-  assert( MPI_Group_incl(group_global, numSortTasks_, sort_comm_ranks.data(), &group_sort) == MPI_SUCCESS);
+  // New communicators for IO, XFER, SORT, and BIN(s) via color
+  // splits. Keys preserve the ordering assumed elsewhere: IO tasks
+  // first in XFER_COMM followed by receivers in sort host order.
 
-  for(int i=0;i<numSortGroups_;i++)
-    assert( MPI_Group_incl(group_global, numSortHosts_, binCommRanks[i].data(), &groups_binning[i]) == MPI_SUCCESS);
+  int color, key;
 
-  fflush(NULL);
+  color = isIOTask_ ? 0 : MPI_UNDEFINED;
+  key   = hostIoIndex;
+  assert( MPI_Comm_split(GLOB_COMM,color,key,&IO_COMM) == MPI_SUCCESS);
 
-  assert( MPI_Comm_create(GLOB_COMM,   group_io,   &IO_COMM) == MPI_SUCCESS);
-  assert( MPI_Comm_create(GLOB_COMM, group_xfer, &XFER_COMM) == MPI_SUCCESS);
-  assert( MPI_Comm_create(GLOB_COMM, group_sort, &SORT_COMM) == MPI_SUCCESS);
+  color = isXFERTask_ ? 0 : MPI_UNDEFINED;
+  key   = isIOTask_ ? hostIoIndex : numIoHosts_ + hostSortIdx;
+  assert( MPI_Comm_split(GLOB_COMM,color,key,&XFER_COMM) == MPI_SUCCESS);
 
-  BIN_COMMS_.reserve(numSortGroups_);
+  color = isSortTask_ ? 0 : MPI_UNDEFINED;
+  key   = hostSortIdx;	// ties broken by global rank
+  assert( MPI_Comm_split(GLOB_COMM,color,key,&SORT_COMM) == MPI_SUCCESS);
 
-  for(int i=0;i<numSortGroups_;i++)
-    assert( MPI_Comm_create(GLOB_COMM, groups_binning[i], &BIN_COMMS_[i]) == MPI_SUCCESS);
+  // sort tasks on this host; bin tasks come first so that the host
+  // rank of a bin task equals its BIN group number
 
-  // is the local rank part of the new groups?
+  color = isSortTask_ ? hostSortIdx : MPI_UNDEFINED;
+  key   = nodeRank;
+  assert( MPI_Comm_split(GLOB_COMM,color,key,&SORT_HOST_COMM) == MPI_SUCCESS);
 
-  int rank_tmp;
+  // a task belongs to at most one binning group -> single split
 
-  isBinTask_.resize(numSortGroups_,false);
+  BIN_COMMS_.assign(numSortGroups_,MPI_COMM_NULL);
 
-  assert( MPI_Group_rank( group_io, &rank_tmp) == MPI_SUCCESS);
-  if(rank_tmp != MPI_UNDEFINED)
-    isIOTask_ = true;
+  MPI_Comm binComm;
+  color = (binNum_ >= 0) ? binNum_ : MPI_UNDEFINED;
+  key   = hostSortIdx;
+  assert( MPI_Comm_split(GLOB_COMM,color,key,&binComm) == MPI_SUCCESS);
 
-  assert( MPI_Group_rank( group_xfer, &rank_tmp) == MPI_SUCCESS);
-  if(rank_tmp != MPI_UNDEFINED)
-    isXFERTask_ = true;
+  if(binNum_ >= 0)
+    BIN_COMMS_[binNum_] = binComm;
 
-  assert( MPI_Group_rank( group_sort, &rank_tmp) == MPI_SUCCESS);
-  if(rank_tmp != MPI_UNDEFINED)
-      isSortTask_ = true;
+  // global ranks of tasks on this host (for IPC partner lookup)
 
-  for(int i=0;i<numSortGroups_;i++)
-    {
-      assert( MPI_Group_rank( groups_binning[i], &rank_tmp) == MPI_SUCCESS);
-      if(rank_tmp != MPI_UNDEFINED)
-	{
-	  isBinTask_[i] = true;
-	  binNum_       = i;
-	}
-    }
-
-  MPI_Barrier(GLOB_COMM);
+  std::vector<int> nodeGlobalRanks(nodeSize);
+  assert( MPI_Allgather(&numLocal_,1,MPI_INT,nodeGlobalRanks.data(),1,MPI_INT,NODE_COMM) == MPI_SUCCESS);
 
   //  cache the new communicator ranks...
 
@@ -713,8 +811,8 @@ void sortio_Class::SplitComm()
 
       if(xferRank_ >= numIoHosts_)
 	{
-	  int index = xferRank_-numIoHosts_;   
-	  localSortRank_ = first_sort_rank[index];
+	  assert(xferRank_ - numIoHosts_ == hostSortIdx);
+	  localSortRank_ = nodeGlobalRanks[xferOffset+1];
 	  grvy_printf(DEBUG,"[sortio] --> IPC setup: XFER rank %i -> global master sort rank %i\n",
 		      xferRank_,localSortRank_);
 	}
@@ -733,15 +831,12 @@ void sortio_Class::SplitComm()
 
       assert( (numIoHosts_ + numSortHosts_) <= numXferTasks_);
 
-      for(int i=0;i<numSortHosts_;i++)
+      if(nodeRank == xferOffset+1)
 	{
-	  if(numLocal_ == first_sort_rank[i])
-	    {
-	      isLocalSortMaster_ = true;
-	      localXferRank_     = xfer_comm_ranks[i+numIoHosts_];
-	      grvy_printf(DEBUG,"[sortio] --> IPC setup: SORT rank %i -> global xfer rank %i\n",
-			  sortRank_,localXferRank_);
-	    }
+	  isLocalSortMaster_ = true;
+	  localXferRank_     = nodeGlobalRanks[xferOffset];
+	  grvy_printf(DEBUG,"[sortio] --> IPC setup: SORT rank %i -> global xfer rank %i\n",
+		      sortRank_,localXferRank_);
 	}
 
       // cache local binning ranks
@@ -753,12 +848,8 @@ void sortio_Class::SplitComm()
 	  assert( MPI_Comm_rank(BIN_COMMS_[i],&binRanks_[i]) == MPI_SUCCESS);
     }
 
-  //gt.EndTimer("MPI task groups");
-
   MPI_Barrier(GLOB_COMM);
 
-
-
   // summarize the config (data printed from master rank to make the output easy on 
   // the eyes for the time being)
 
@@ -767,7 +858,7 @@ void sortio_Class::SplitComm()
   if(master)
     {
       grvy_printf(INFO,"[sortio]\n");
-      grvy_printf(INFO,"[sortio] MPI WorkGroup Summary (%i hosts, %i MPI tasks)\n",uniq_hosts.size(),numTasks_);
+      grvy_printf(INFO,"[sortio] MPI WorkGroup Summary (%i hosts, %i MPI tasks)\n",numHosts,numTasks_);
 
       grvy_printf(INFO,"[sortio] --> Communicator Ranking Demarcation\n");
       grvy_printf(INFO,"[sortio]\n");
@@ -790,19 +881,17 @@ void sortio_Class::SplitComm()
 
   const int numColumns = 3 + numSortGroups_;
   int *ranks_tmp;
+  char remoteHost[MPI_MAX_PROCESSOR_NAME];
 
   ranks_tmp = new int[numColumns];
   MPI_Status status;
 
   for(int proc=0;proc<numTasks_;proc++)
     {
-      if(master)
-	{
-	  grvy_printf(INFO,"[sortio]  %.8s    %.6i ",&hostnames_ALL[proc*MPI_MAX_PROCESSOR_NAME],proc);
-	}
-
       if(master && (proc == 0) )
 	{
+	  grvy_printf(INFO,"[sortio]  %.8s    %.6i ",hostname,proc);
+
 	  if(isIOTask_)
 	    printf("  %.6i",ioRank_);
 	  else
@@ -830,13 +919,17 @@ void sortio_Class::SplitComm()
 	  for(int i=0;i<numSortGroups_;i++)
 	    ranks_tmp[i+3] = (isBinTask_[i] ) ? binRanks_[i] : -1 ;
 
+	  assert (MPI_Send(hostname,MPI_MAX_PROCESSOR_NAME,MPI_CHAR,0,101,GLOB_COMM) == MPI_SUCCESS) ;
 	  assert (MPI_Send(ranks_tmp,numColumns,MPI_INT,0,100,GLOB_COMM) == MPI_SUCCESS) ;
 	}
       
       if(master)
 	{
+	  assert (MPI_Recv(remoteHost,MPI_MAX_PROCESSOR_NAME,MPI_CHAR,proc,101,GLOB_COMM,&status) == MPI_SUCCESS) ;
 	  assert (MPI_Recv(ranks_tmp,numColumns,MPI_INT,proc,100,GLOB_COMM,&status) == MPI_SUCCESS) ;
 
+	  grvy_printf(INFO,"[sortio]  %.8s    %.6i ",remoteHost,proc);
+
 	  for(int i=0;i<3;i++)
 	    {
 	      if(ranks_tmp[i] >= 0)
@@ -878,14 +971,9 @@ void sortio_Class::SplitComm()
 
   // clean-up
 
-  assert (MPI_Group_free(&group_io  ) == MPI_SUCCESS );
-  assert (MPI_Group_free(&group_xfer) == MPI_SUCCESS );
-  assert (MPI_Group_free(&group_sort) == MPI_SUCCESS );
-  for(int i=0;i<numSortGroups_;i++)
-    assert (MPI_Group_free(&groups_binning[i]) == MPI_SUCCESS );
-
-  if(master)
-    free(hostnames_ALL);  
+  if(LEADER_COMM != MPI_COMM_NULL)
+    assert (MPI_Comm_free(&LEADER_COMM) == MPI_SUCCESS );
+  assert (MPI_Comm_free(&NODE_COMM) == MPI_SUCCESS );
 
   // initialize space for small buffered sends
 
@@ -898,10 +986,239 @@ void sortio_Class::SplitComm()
       MPI_Buffer_attach( bsendBuf_, bufSize );
     }
 
+  // derive bin counts and run sizes from the memory budget (requires
+  // the number of sort hosts)
+
+  planMemoryBudget();
+
   gt.EndTimer("SplitComm");
   return;
 }
 
+// --------------------------------------------------------------------
+// planHostLayout(): assign IO and SORT roles to each host. IO hosts
+// are selected round-robin across network switch groups so that
+// reads/transfers are spread over the fabric (hosts without topology
+// info form their own group, which reduces to the original
+// alphabetical selection). In hybrid mode (io_hosts_sort), IO hosts
+// also participate in sorting using 1 task for IO, 1 task for XFER
+// receives, and the remainder for sorting.
+// --------------------------------------------------------------------
+
+void sortio_Class::planHostLayout(std::vector<HostLayout> &hosts)
+{
+  const int numHosts = hosts.size();
+
+  assert(numIoHosts_ <= numHosts);
+
+  // group hosts by switch id (in order of first appearance)
+
+  std::vector< std::vector<int> > switchGroups;
+  std::map<int,int> switchIndex;
+
+  for(int i=0;i<numHosts;i++)
+    {
+      hosts[i].isIO       = false;
+      hosts[i].isSort     = false;
+      hosts[i].ioIndex    = -1;
+      hosts[i].sortIndex  = -1;
+      hosts[i].xferOffset = 0;
+
+      if(hosts[i].switchId < 0)
+	{
+	  switchGroups.push_back(std::vector<int>(1,i));
+	}
+      else
+	{
+	  if(switchIndex.find(hosts[i].switchId) == switchIndex.end())
+	    {
+	      switchIndex[hosts[i].switchId] = switchGroups.size();
+	      switchGroups.push_back(std::vector<int>());
+	    }
+	  switchGroups[switchIndex[hosts[i].switchId]].push_back(i);
+	}
+    }
+
+  // round-robin IO host selection across switch groups
+
+  int numAssigned = 0;
+  size_t depth    = 0;
+
+  while(numAssigned < numIoHosts_)
+    {
+      for(size_t group=0;group<switchGroups.size() && numAssigned < numIoHosts_;group++)
+	{
+	  if(depth < switchGroups[group].size())
+	    {
+	      int host = switchGroups[group][depth];
+	      hosts[host].isIO    = true;
+	      hosts[host].ioIndex = numAssigned++;
+	    }
+	}
+      depth++;
+    }
+
+  // remaining roles: hosts without enough tasks for all binning
+  // groups (plus XFER receiver) are excluded from sorting
+
+  int numSort = 0;
+
+  for(int i=0;i<numHosts;i++)
+    {
+      if(hosts[i].isIO && !ioHostsSort_)
+	continue;
+
+      int offset = hosts[i].isIO ? 1 : 0;
+
+      if(hosts[i].numTasks < numSortGroups_ + 1 + offset)
+	{
+	  grvy_printf(INFO,"[sortio] Warning: host %i has too few MPI tasks (%i) for %i bin group(s); excluded from SORT\n",
+		      i,hosts[i].numTasks,numSortGroups_);
+	  continue;
+	}
+
+      hosts[i].isSort     = true;
+      hosts[i].sortIndex  = numSort++;
+      hosts[i].xferOffset = offset;
+    }
+
+  return;
+}
+
+// --------------------------------------------------------------------
+// readTopologyFile(): parse optional "hostname switch_id" pairs used
+// for topology-aware IO host placement (lines beginning with # are
+// ignored).
+// --------------------------------------------------------------------
+
+std::map<std::string,int> sortio_Class::readTopologyFile()
+{
+  std::map<std::string,int> switches;
+
+  if(topologyFile_.size() == 0)
+    return(switches);
+
+  FILE *fp = fopen(topologyFile_.c_str(),"r");
+  if(fp == NULL)
+    grvy_printf(ERROR,"[sortio] Unable to access topology file %s\n",topologyFile_.c_str());
+
+  assert(fp != NULL);
+
+  char line[1024];
+  char host[1024];
+  int  id;
+
+  while(fgets(line,sizeof(line),fp) != NULL)
+    {
+      if(line[0] == '#')
+	continue;
+      if(sscanf(line,"%1023s %i",host,&id) == 2)
+	switches[host] = id;
+    }
+
+  fclose(fp);
+
+  grvy_printf(INFO,"[sortio] Read switch ids for %i hosts from %s\n",(int)switches.size(),topologyFile_.c_str());
+
+  return(switches);
+}
+
+// --------------------------------------------------------------------
+// planMemoryBudget(): when host_mem_mbs is set, choose the number of
+// sort bins, final sort concurrency and binning run size from the
+// total input size, per-host memory and number of sort hosts so that
+// every final sort bin fits in memory with a safety margin. The final
+// sort memory budget (final_sort_mem_mbs) is set to the usable memory
+// so that the plan is enforced at runtime (see reserveFinalSortMem()).
+//
+// Model (per host, usable = SAFETY*host_mem_mbs):
+//   - a resident final-sort bin is charged 2x its data size
+//   - each final group may hold 3 bins (prefetch, sort, write)
+//   - a binning run needs ~4x its size (buffer, partition, buckets,
+//     async write queue)
+// --------------------------------------------------------------------
+
+void sortio_Class::planMemoryBudget()
+{
+  const double SAFETY     = 0.75;
+  const double MB         = 1024.0*1024.0;
+  const int    BINS_LIVE  = 3;	  // resident bins per final group
+  const int    BIN_FACTOR = 2;	  // charge per resident bin (x data size)
+  const int    RUN_FACTOR = 4;	  // memory per binning run (x run size)
+
+  if(hostMemMBs_ <= 0)
+    return;
+
+  // total input size: all input files are assumed to be the size of the first
+
+  double fileBytes = 0.0;
+
+  if(master)
+    {
+      std::string infile = inputDir_ + "/" + fileBaseName_ + "0";
+      struct stat st;
+
+      if(stat(infile.c_str(),&st) == 0)
+	fileBytes = st.st_size;
+      else
+	{
+	  grvy_printf(INFO,"[sortio] Warning: unable to stat %s for planning, assuming %i MBs/file\n",
+		      infile.c_str(),MAX_FILE_SIZE_IN_MBS);
+	  fileBytes = MAX_FILE_SIZE_IN_MBS*MB;
+	}
+    }
+
+  assert( MPI_Bcast(&fileBytes,1,MPI_DOUBLE,0,GLOB_COMM) == MPI_SUCCESS );
+
+  const double totalBytes  = fileBytes*numFilesTotal_;
+  const double hostBytes   = totalBytes/numSortHosts_;
+  const double usableBytes = SAFETY*hostMemMBs_*MB;
+
+  // fewest bins such that one final group can keep its pipeline full
+
+  int numBins = (int)ceil(BINS_LIVE*BIN_FACTOR*hostBytes/usableBytes);
+  numBins     = std::max(numBins,1);
+
+  const double binBytes = hostBytes/numBins;
+
+  // as many concurrent final groups as fit (limited by tasks per host)
+
+  int numFinal = (binBytes > 0) ? (int)(usableBytes/(BINS_LIVE*BIN_FACTOR*binBytes)) : numSortGroups_;
+  numFinal     = std::max(1,std::min(numFinal,numSortGroups_));
+
+  // binning run size per host (an explicit, smaller setting is kept)
+
+  int runMBs = (int)(std::min(usableBytes/RUN_FACTOR,hostBytes)/MB);
+  runMBs     = std::max(runMBs,1);
+
+  if( (targetRunSizeMBs_ > 0) && (targetRunSizeMBs_ < runMBs) )
+    runMBs = targetRunSizeMBs_;
+
+  numSortBins_        = numBins;
+  numFinalSortGroups_ = numFinal;
+  targetRunSizeMBs_   = runMBs;
+  finalSortMemMBs_    = (int)(usableBytes/MB);
+
+  if(master)
+    {
+      grvy_printf(INFO,"[sortio]\n");
+      grvy_printf(INFO,"[sortio] Memory plan (host_mem_mbs = %i, safety = %.2f):\n",hostMemMBs_,SAFETY);
+      grvy_printf(INFO,"[sortio] --> Total input size                = %.1f MBs\n",totalBytes/MB);
+      grvy_printf(INFO,"[sortio] --> Input per sort host             = %.1f MBs\n",hostBytes/MB);
+      grvy_printf(INFO,"[sortio] --> Number of sort bins             = %i\n",numSortBins_);
+      grvy_printf(INFO,"[sortio] --> Final sort bin size/host        = %.1f MBs\n",binBytes/MB);
+      grvy_printf(INFO,"[sortio] --> Number of sort groups ( final ) = %i\n",numFinalSortGroups_);
+      grvy_printf(INFO,"[sortio] --> Final sort memory/host          = %i MBs\n",finalSortMemMBs_);
+      grvy_printf(INFO,"[sortio] --> Target binning run size         = %i MBs\n",targetRunSizeMBs_);
+
+      double writerMBs = 4.0*numSortBins_*numSortGroups_;   // BucketWriter buffers per host
+      if(writerMBs > 0.1*usableBytes/MB)
+	grvy_printf(INFO,"[sortio] Warning: bucket write buffers need %.0f MBs/host\n",writerMBs);
+    }
+
+  return;
+}
+
 // --------------------------------------------------------------------
 // Reenable input buffer for use by reader tasks by adding to the
 // Empty queue 
@@ -997,6 +1314,10 @@ void printResults( MPI_Comm comm) {
 		if (!myrank) {	
 			std::cout << "comm split        \t\t\t" << meanV << "\t" << minV << "\t" << maxV <<  std::endl; 
 		}
+		t = seq::simd_kernels().level; 				getStats(t, &meanV, &minV, &maxV, comm);
+		if (!myrank) {
+			std::cout << "SIMD level        \t\t\t" << meanV << "\t" << minV << "\t" << maxV << "\t(" << seq::simd_kernels().name << " on rank 0)" << std::endl;
+		}
 		//#endif
 		if (!myrank) {			
 			// std::cout << "---------------------------------------------------------------------------" << std::endl;
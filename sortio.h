@@ -39,10 +39,15 @@
 #include <cstdlib>
 #include <ctime>
 #include <cstring>
+#include <cmath>
 #include <sstream>
 #include <algorithm>
 #include <queue>
 #include <list>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <pthread.h>
 
 #define _PROFILE_SORT
 #include "binOps/binUtils.h"
@@ -58,6 +63,7 @@
 #include <boost/interprocess/sync/interprocess_mutex.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
 #include <boost/interprocess/sync/interprocess_condition.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include "grvy.h"
 
 #ifdef _OPENMP
@@ -118,6 +124,50 @@ struct shmem_xfer_sync
   size_t bufSizeAvail;
 };
 
+// SHMEM data structure between SORT_COMM tasks on one host during the
+// final sort: bins are admitted in order and charged against a per-host
+// memory budget while they are resident
+
+struct shmem_finalsort_sync
+{
+  boost::interprocess::interprocess_mutex     mutex;
+  boost::interprocess::interprocess_condition condMemReleased;
+  size_t activeBytes;		// bytes charged by resident bins
+  size_t pinnedBytes;		// part of activeBytes held by in-memory runs awaiting their bin
+  int    nextBin;		// next bin allowed to reserve memory
+  int    spareCores;		// cores donated to other tasks' sort pools (task_pool = 2)
+};
+
+// One bin moving through the final sort pipeline; read and write
+// stages run on a background thread (see manageSortProcess())
+
+struct FinalBinStage
+{
+  int    ibin;
+  bool   active;			// background thread in flight?
+  pthread_t thread;
+  size_t reserved;			// bytes charged against the host budget
+  std::vector<std::string> files;	// tmp bucket files to read
+  std::string outFile;			// output file (write stage)
+  std::vector<sortRecord>  data;
+  bool   recycle;			// keep data's capacity after the write for the next bin
+  class  sortio_Class *sortio;
+  shmem_finalsort_sync *sync;
+};
+
+// Per-host role assignment used to build the MPI work groups (see SplitComm())
+
+struct HostLayout
+{
+  int  numTasks;		// # of MPI tasks on this host
+  int  switchId;		// network switch/rack id (-1 = unknown)
+  bool isIO;			// host provides a dedicated IO task (first local rank)
+  bool isSort;			// host provides an XFER receive task and SORT tasks
+  int  ioIndex;			// order of host amongst IO hosts   (-1 if not IO)
+  int  sortIndex;		// order of host amongst SORT hosts (-1 if not SORT)
+  int  xferOffset;		// local rank of the receiving XFER task (if isSort)
+};
+
 class sortio_Class {
 
  public:
@@ -140,11 +190,34 @@ class sortio_Class {
   void beginRecvTransferProcess();
   int  CycleDestRank();
   void checkForSendCompletion(bool waitFlag, int waterMark, int iter);
+  void initRmaXfer           (unsigned char *buffer, size_t bufSize);
+  void rmaSendBuffer         (unsigned char *buffer, int payLoadSize, int destRank);
+  int  rmaWaitForBuffer      ();
+  void freeRmaXfer           ();
   void addBuffertoEmptyQueue (int bufNum);
   void cycleBinGroup         (int numFilesTotal,int currentGroup);
+  void summarizeBinGroups    ();
+  void reportBucketImbalance (std::vector<int> &writeCounts, MPI_Comm comm, int outputCount);
+  size_t readTmpFiles        (std::vector<std::string> &files, std::vector<sortRecord> &data);
+  size_t tmpFilesBytes       (std::vector<std::string> &files);
+  void   exchangeMemRuns     (par::BucketWriter &writer, std::vector< std::vector<sortRecord> > &memBins,
+			      std::vector< std::vector<DendroIntL> > &memRuns);
+  void   finalBinFiles       (int ibin, int sortGroup, int numBinGroups, std::vector<std::string> &files,
+			      std::vector<DendroIntL> &runs);
+  bool   reserveFinalSortMem (shmem_finalsort_sync *sync, int ibin, size_t bytes, bool wait);
+  void   startFinalStage     (FinalBinStage &stage);
+  void   waitFinalStage      (FinalBinStage &stage);
+  static void releaseFinalSortMem(shmem_finalsort_sync *sync, size_t bytes);
+  static void pinFinalSortMem    (shmem_finalsort_sync *sync, size_t bytes, bool pin);
+  static void *finalStageWork(void *arg);
+  bool waitForIpcData        (shmem_xfer_sync *sync, int &bufSize, int timeoutMs = 10);
+  void waitForRequest        (MPI_Request *request);
   void doInRamSort();
   int  waitForActivation();
   int  isPowerOfTwo(unsigned int x);
+  void planHostLayout        (std::vector<HostLayout> &hosts);
+  void planMemoryBudget      ();
+  std::map<std::string,int> readTopologyFile();
   //  void setupMMAP_SortSync();
 
  private:
@@ -164,11 +237,24 @@ class sortio_Class {
   int  numSortHosts_;			 // total # of detected sort hosts;
   int  numSortGroups_;			 // number of sort groups during bucketing process
   int  numFinalSortGroups_;              // number of groups during final sort
-  int  numMaxFinalSorters_;		 // number of max simultaneous sorters allowed
+  int  finalSortMemMBs_;		 // per-host memory budget for resident final sort bins (0=unlimited)
+  int  hostMemMBs_;			 // per-host memory budget used to plan bins/runs (0=manual settings)
+  int  binMemMBs_;			 // per-host memory for keeping binned runs in RAM (0=always spill)
   int  verifyMode_;			 // verification mode (1=input data)
   int  sortMode_;                        // sort mode (0=disable)
   int  useSkewSort_;			 // flag to enable skewed data sort mode
+  int  useRmaXfer_;			 // flag to enable one-sided (MPI_Put) IO->XFER transport
+  int  ioHostsSort_;			 // flag to also place XFER/SORT tasks on IO hosts (hybrid layout)
   int  numSortBins_;			 // total # of sort bins
+  int  targetRunSizeMBs_;		 // target binning run size per host (0=legacy heuristic)
+  int  asyncWriteMBs_;			 // max MBs queued for background bucket writes (0=synchronous)
+  int  binRebalance_;			 // flag to load balance each bucket across BIN_COMM on every pass
+  int  directTmpRead_;			 // flag to re-read temporary bucket files with O_DIRECT
+  int  finalMerge_;			 // flag to merge sorted runs in final sort (instead of re-sorting)
+  int  localSortMethod_;		 // node-local sort algorithm (omp_par::LocalSortMethod)
+  int  simdLevel_;			 // max SIMD kernel level (seq::SimdLevel, -1=best supported)
+  int  numaMerge_;			 // merge_sort placement policy (omp_par::MergePolicy)
+  int  taskPool_;			 // final sort kernels on a task pool (0=OpenMP,1=pool,2=pool+host core sharing)
 
   unsigned long numRecordsRead_;         // total # of records read locally
   unsigned long recordsPerFile_;         // # of records read locally per file (assumed constant)
@@ -177,6 +263,7 @@ class sortio_Class {
   std::string inputDir_;	         // input directory
   std::string outputDir_;		 // output directory
   std::string tmpDir_;                   // temporary file creation directory
+  std::string topologyFile_;             // optional hostname -> switch id mapping
 
   GRVY::GRVY_Timer_Class gt;             // performance timer
 
@@ -220,6 +307,9 @@ class sortio_Class {
 
   size_t   dataTransferred_;		 // amount of data transferred to receiving tasks
   std::list <MsgRecord> messageQueue_;   // in-flight message queue
+  MPI_Win  xferDataWin_;		 // RMA window exposing IPC receive buffer (one-sided mode)
+  MPI_Win  xferFlagWin_;		 // RMA window with [ready,payload size] flags (one-sided mode)
+  long    *xferFlags_;			 // local storage for xferFlagWin_
   
   // Data sort tasks
 
@@ -232,7 +322,9 @@ class sortio_Class {
   int      localXferRank_;		// MPI rank in GLOB_COMM for the XFER task on same host
   int      numSortThreads_;		// number of final sort threads (OMP)
   MPI_Comm SORT_COMM;		        // MPI communicator for data sort tasks
+  MPI_Comm SORT_HOST_COMM;		// MPI communicator for sort tasks on the same host
   std::vector<sortRecord> readBuf_;	// read buffer for use in naive sort mode
+  par::SortArena<sortRecord> arena_;	// binning/final sort buffers reused across passes and bins
 
   // Binning tasks which overlap with SORT
 
@@ -243,6 +335,11 @@ class sortio_Class {
   int binRingRank_;		        // global rank for neighboring ring task
   int activeBin_;			// currently active BIN comm
   int binNum_;				// BIN number for local rank
+  int binCycleMsg_;			// payload for pending ring activation send
+  MPI_Request binCycleReq_;		// pending ring activation send (non-blocking)
+  int binActivations_;			// number of times local BIN group went active
+  double binIdleTime_;			// time spent waiting for BIN group activation
+  double binActiveTime_;		// time spent receiving/binning/writing while active
   
 };
 
@@ -114,6 +114,12 @@ void sortio_Class::beginRecvTransferProcess()
 
   MPI_Send(&handshake,1,MPI_INTEGER,localSortRank_,1,GLOB_COMM);
 
+  // one-sided transport: expose the IPC receive buffer directly to the
+  // sending IO tasks
+
+  if(useRmaXfer_)
+    initRmaXfer(buffer,maxMessagesToSend_*MAX_FILE_SIZE_IN_MBS*1024*1024*sizeof(unsigned char));
+
   // Main Recv loop; each rank takes a turn receiving file
   // contents and distributing to local SORT_COMM processes for
   // subsequent sort; recv here is blocking but can match any source,
@@ -193,10 +199,14 @@ void sortio_Class::beginRecvTransferProcess()
 	  grvy_printf(DEBUG,"[sortio][XFER/Recv][%.4i] initiating recv (iter=%i, tag=%i)\n",
 		      xferRank_,iter,tagXFER);
 
-	  // receive info regarding size (number) of messages, followed by raw data
+	  // receive info regarding size (number) of messages, followed by
+	  // raw data (in one-sided mode, the payload has already landed
+	  // once the size is available)
 
-	  
-	  MPI_Recv(&messageSizeIncoming,1,MPI_INT,MPI_ANY_SOURCE,tagXFER,XFER_COMM,&status1);
+	  if(useRmaXfer_)
+	    messageSizeIncoming = rmaWaitForBuffer();
+	  else
+	    MPI_Recv(&messageSizeIncoming,1,MPI_INT,MPI_ANY_SOURCE,tagXFER,XFER_COMM,&status1);
 
 	  numFilesReceived += messageSizeIncoming/messageSize;
 
@@ -220,7 +230,8 @@ void sortio_Class::beginRecvTransferProcess()
 	  MPI_Send(&numFilesReceived,1,MPI_INT,destRank,13,XFER_COMM);
 
 	  // now, actual data receive
-	  MPI_Recv(&buffer[0],messageSizeIncoming,MPI_UNSIGNED_CHAR,status1.MPI_SOURCE,tagXFER+1,XFER_COMM,&status2);
+	  if(!useRmaXfer_)
+	    MPI_Recv(&buffer[0],messageSizeIncoming,MPI_UNSIGNED_CHAR,status1.MPI_SOURCE,tagXFER+1,XFER_COMM,&status2);
 
 	  grvy_printf(DEBUG,"[sortio][XFER/Recv][%.4i] completed recv (iter=%i)\n",xferRank_,iter);
 
@@ -247,6 +258,7 @@ void sortio_Class::beginRecvTransferProcess()
 	    scoped_lock<interprocess_mutex> lock(syncFlags2->mutex);
 	    syncFlags2->isReadyForNewData = false;
 	    syncFlags2->bufSizeAvail      = messageSizeIncoming;
+	    syncFlags2->condFull.notify_all();
 	  }
 
 	  dataTransferred_ += messageSizeIncoming;
@@ -274,6 +286,9 @@ void sortio_Class::beginRecvTransferProcess()
 
   gt.EndTimer("XFER/Recv");
 
+  if(useRmaXfer_)
+    freeRmaXfer();
+
 #if 0
   int dataTransferredLocal = dataTransferred_;
   MPI_Allreduce(&dataTransferredLocal,&dataTransferred_,1,MPI_LONG,MPI_SUM,XFER_COMM);
@@ -301,3 +316,45 @@ void sortio_Class::beginRecvTransferProcess()
 
   return;
 }
+
+// --------------------------------------------------------------------
+// rmaWaitForBuffer(): (receiver side of one-sided transport) arm the
+// local IPC receive buffer for the next payload and wait for a sending
+// IO task to deposit it. Returns the payload size in bytes.
+//
+// Note: caller must guarantee that the previous payload has been
+// consumed by the local SORT task prior to arming.
+// --------------------------------------------------------------------
+
+int sortio_Class::rmaWaitForBuffer()
+{
+  const int USLEEP_INTERVAL = 1000;
+  const long armed          = 1;
+  const long empty          = 0;
+  long size                 = 0;
+
+  assert(xferFlags_ != NULL);
+
+  MPI_Accumulate(&armed,1,MPI_LONG,xferRank_,0,1,MPI_LONG,MPI_REPLACE,xferFlagWin_);
+  MPI_Win_flush(xferRank_,xferFlagWin_);
+
+  while(true)
+    {
+      MPI_Fetch_and_op(NULL,&size,MPI_LONG,xferRank_,1,MPI_NO_OP,xferFlagWin_);
+      MPI_Win_flush(xferRank_,xferFlagWin_);
+
+      if(size > 0)
+	break;
+
+      usleep(USLEEP_INTERVAL);
+    }
+
+  MPI_Accumulate(&empty,1,MPI_LONG,xferRank_,1,1,MPI_LONG,MPI_REPLACE,xferFlagWin_);
+  MPI_Win_flush(xferRank_,xferFlagWin_);
+
+  // make the remotely written payload visible to local loads
+
+  MPI_Win_sync(xferDataWin_);
+
+  return((int)size);
+}